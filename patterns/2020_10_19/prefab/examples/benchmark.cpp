@@ -0,0 +1,106 @@
+﻿#include <string>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include "prefab/Repository.hpp"
+#include "prefab/FlatRepository.hpp"
+
+using namespace prefab;
+
+namespace
+{
+    double g_sum = 0.0;
+
+    template<typename Fn>
+    double measure(Fn&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(stop - start).count();
+    }
+
+    //keyOf:新建存储库中第i个实体的标识符,两种实现的编码方式不同
+    template<typename R, typename KeyOf>
+    void run(const char* name, std::size_t n, KeyOf&& keyOf) {
+        R repo;
+        repo.template registerComponentRepo<int>();
+        repo.template registerComponentRepo<double>();
+        repo.template registerComponentRepo<std::string>();
+
+        auto create = measure([&]() {
+            for (std::size_t i = 0; i < n; i++) {
+                auto e = repo.template create<int, double, std::string>();
+                e.template assign<int>(static_cast<int>(i));
+                e.template assign<double>(i * 0.5);
+                e.template assign<std::string>("entity");
+            }
+            });
+
+        std::mt19937 gen{ 42 };
+        std::uniform_int_distribution<std::size_t> pick{ 0, n - 1 };
+        const std::size_t lookups = n / 10;
+        auto find = measure([&]() {
+            for (std::size_t i = 0; i < lookups; i++) {
+                auto key = keyOf(pick(gen));
+                auto e = repo.template find<int, double>(Require(static_cast<long long>(key)));
+                if (e) {
+                    g_sum += e.template view<double>();
+                }
+            }
+            });
+
+        auto search = measure([&]() {
+            for (auto e : repo.template search<int, double>()) {
+                g_sum += e.template view<int>();
+            }
+            });
+
+        auto destory = measure([&]() {
+            for (std::size_t i = 0; i < n; i += 2) {
+                repo.template destory<>(Require(static_cast<long long>(keyOf(i))).remark(""_hashed, "=="_hashed));
+            }
+            repo.template destory<>();
+            });
+
+        std::printf("%-8s %8zu: create %9.2f ms, find %8.2f ms, search %9.2f ms, destory %9.2f ms\n",
+            name, n, create, find, search, destory);
+    }
+
+    //按要求筛选一半实体:实体包装的search与编译后查询的标识符游标
+    void runQuery(std::size_t n) {
+        flat::Repository repo;
+        repo.registerComponentRepo<int>();
+        repo.registerComponentRepo<double>();
+        for (std::size_t i = 0; i < n; i++) {
+            auto e = repo.create<int, double>();
+            e.assign<int>(static_cast<int>(i));
+            e.assign<double>(i * 0.5);
+        }
+        auto req = [&]() { return Require(static_cast<int>(n / 2)).remark(""_hashed, "<"_hashed); };
+
+        auto search = measure([&]() {
+            for (auto e : repo.search<int, double>(req())) {
+                g_sum += e.view<double>();
+            }
+            });
+
+        auto query = repo.compile<int>(req());
+        auto select = measure([&]() {
+            for (auto key : repo.select(query)) {
+                g_sum += *repo.view<double>(key);
+            }
+            });
+        std::printf("query    %8zu: search %9.2f ms, select %9.2f ms\n", n, search, select);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    for (std::size_t n : { 100000, 1000000 }) {
+        run<verify::Repository>("verify", n, [](std::size_t i) { return static_cast<long long>(i); });
+        run<flat::Repository>("flat", n, [](std::size_t i) { return static_cast<long long>((1ull << 32) | i); });
+        runQuery(n);
+    }
+    std::printf("checksum %.0f\n", g_sum);
+    return 0;
+}
@@ -0,0 +1,828 @@
+﻿#pragma once
+#include <vector>
+#include <array>
+#include <memory>
+#include <new>
+#include <limits>
+#include <cstdint>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+#include <iterator>
+#include <algorithm>
+#include "prefab/IRepository.hpp"
+
+namespace prefab
+{
+    //基于列存储的内存存储库,接口与verify::Repository一致
+    //1.实体标识符由槽位索引与代数组成,销毁后槽位复用,旧标识符不会误命中新实体
+    //2.每种数据组件一列,值紧凑连续存储,创建/销毁实体不为单个实体分配内存
+    //3.实体/实体集合持有的数据组件就地构造,不再逐个分配
+    //4.要求可编译为查询,按批求值并以实体标识符游标返回结果,配合view<T>(key)访问值
+    namespace flat
+    {
+        class Repository;
+
+        namespace detail
+        {
+            template<typename T, typename = void>
+            struct is_equality_comparable :std::false_type {};
+
+            template<typename T>
+            struct is_equality_comparable<T, decltype(void(std::declval<T const&>() == std::declval<T const&>()))> :std::true_type {};
+
+            template<typename T, typename = void>
+            struct is_less_comparable :std::false_type {};
+
+            template<typename T>
+            struct is_less_comparable<T, decltype(void(std::declval<T const&>() < std::declval<T const&>()))> :std::true_type {};
+        }
+
+        //比较方式,由要求的remark(""_hashed)指定,缺省为相等
+        enum class Compare {
+            eq,
+            ne,
+            lt,
+            le,
+            gt,
+            ge,
+        };
+
+        inline Compare compareOf(Require const& req) {
+            auto remark = req.remark(""_hashed);
+            if (!remark || remark == "=="_hashed) return Compare::eq;
+            if (remark == "!="_hashed) return Compare::ne;
+            if (remark == "<"_hashed) return Compare::lt;
+            if (remark == "<="_hashed) return Compare::le;
+            if (remark == ">"_hashed) return Compare::gt;
+            if (remark == ">="_hashed) return Compare::ge;
+            throw std::invalid_argument("flat repository can't process require remark");
+        }
+
+        //编译后的筛选条件:按批对列中紧凑存储的值求值,避免逐个实体的间接调用
+        class IPredicate
+        {
+        public:
+            virtual ~IPredicate() = default;
+            //可求值的位置数量,即列中值的数量
+            virtual std::size_t size() const noexcept = 0;
+            //对位置[first,last)求值,满足条件的槽位索引写入out(容量不小于last-first),返回写入数量
+            virtual std::size_t evaluate(std::size_t first, std::size_t last, std::uint32_t* out) const noexcept = 0;
+        };
+
+        //数据组件列的类型擦除接口
+        class IColumn
+        {
+        public:
+            virtual ~IColumn() = default;
+
+            virtual HashedStringLiteral typeCode() const noexcept = 0;
+            virtual bool contains(std::uint32_t index) const noexcept = 0;
+            virtual void erase(std::uint32_t index) noexcept = 0;
+            virtual void clear() noexcept = 0;
+            //在buffer上构造槽位index的数据组件接口实现
+            virtual IComponentBase* construct(void* buffer, Repository const* repo, long long key) noexcept = 0;
+            //以创建参数写入槽位index
+            virtual void write(std::uint32_t index, Value const& argument) = 0;
+            //将要求编译为针对该列的筛选条件
+            virtual std::unique_ptr<IPredicate> compile(Require const& req) const = 0;
+        };
+
+        template<typename T>
+        class Column;
+
+        //列存储的数据组件接口实现,只记录列与实体标识符
+        template<typename T>
+        class Component :public IComponent<T>
+        {
+            Column<T>* m_column = nullptr;
+            Repository const* m_repo = nullptr;
+            long long m_key = -1;
+        public:
+            explicit Component(Column<T>* column, Repository const* repo, long long key) noexcept
+                :m_column(column), m_repo(repo), m_key(key) {};
+
+            HashedStringLiteral implTypeCode() const noexcept override {
+                return HashedTypeNameOf<Component<T>>();
+            }
+
+            bool exist() const noexcept override;
+            T    view() const override;
+            bool remove() noexcept override;
+            bool assign(T const& v) noexcept override;
+            //值不存在时不做修改,返回v
+            T    replace(T const& v) noexcept override;
+        };
+
+        //数据组件列:稀疏集,槽位索引到紧凑位置的映射 + 紧凑存储的值及其槽位索引
+        template<typename T>
+        class Column final :public IColumn
+        {
+            static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+            std::vector<std::uint32_t> m_positions;
+            std::vector<T> m_values;
+            std::vector<std::uint32_t> m_indexs;
+        public:
+            Column() = default;
+
+            HashedStringLiteral typeCode() const noexcept override {
+                return HashedTypeNameOf<T>();
+            }
+
+            std::size_t size() const noexcept {
+                return m_values.size();
+            }
+
+            bool contains(std::uint32_t index) const noexcept override {
+                return index < m_positions.size() && m_positions[index] != npos;
+            }
+
+            T* at(std::uint32_t index) noexcept {
+                return contains(index) ? &m_values[m_positions[index]] : nullptr;
+            }
+
+            const T* at(std::uint32_t index) const noexcept {
+                return contains(index) ? &m_values[m_positions[index]] : nullptr;
+            }
+
+            //值已存在时返回false
+            bool assign(std::uint32_t index, T const& v) {
+                if (contains(index)) return false;
+                if (index >= m_positions.size()) {
+                    m_positions.resize(index + 1, npos);
+                }
+                m_values.emplace_back(v);
+                m_indexs.emplace_back(index);
+                m_positions[index] = static_cast<std::uint32_t>(m_values.size() - 1);
+                return true;
+            }
+
+            //以末尾值填补被移除值的位置
+            void erase(std::uint32_t index) noexcept override {
+                if (!contains(index)) return;
+                auto pos = m_positions[index];
+                auto last = static_cast<std::uint32_t>(m_values.size() - 1);
+                if (pos != last) {
+                    m_values[pos] = std::move(m_values[last]);
+                    m_indexs[pos] = m_indexs[last];
+                    m_positions[m_indexs[pos]] = pos;
+                }
+                m_values.pop_back();
+                m_indexs.pop_back();
+                m_positions[index] = npos;
+            }
+
+            void clear() noexcept override {
+                m_positions.clear();
+                m_values.clear();
+                m_indexs.clear();
+            }
+
+            IComponentBase* construct(void* buffer, Repository const* repo, long long key) noexcept override;
+
+            void write(std::uint32_t index, Value const& argument) override {
+                assign(index, argument.as<T>());
+            }
+
+            std::unique_ptr<IPredicate> compile(Require const& req) const override;
+
+            const T* values() const noexcept {
+                return m_values.data();
+            }
+
+            const std::uint32_t* indexs() const noexcept {
+                return m_indexs.data();
+            }
+        };
+
+        template<typename T>
+        class Predicate final :public IPredicate
+        {
+            Column<T> const* m_column = nullptr;
+            T m_value;
+            Compare m_compare;
+
+            //不分支地写入:每个位置都写,满足条件时才前进
+            template<typename F>
+            std::size_t scan(std::size_t first, std::size_t last, std::uint32_t* out, F&& fn) const noexcept {
+                auto values = m_column->values();
+                auto indexs = m_column->indexs();
+                std::size_t n = 0;
+                for (auto i = first; i < last; i++) {
+                    out[n] = indexs[i];
+                    n += fn(values[i]) ? 1 : 0;
+                }
+                return n;
+            }
+        public:
+            explicit Predicate(Column<T> const* column, T const& v, Compare compare)
+                :m_column(column), m_value(v), m_compare(compare)
+            {
+                if constexpr (!detail::is_equality_comparable<T>::value) {
+                    if (compare == Compare::eq || compare == Compare::ne) {
+                        throw std::invalid_argument("flat repository can't compare component value");
+                    }
+                }
+                if constexpr (!detail::is_less_comparable<T>::value) {
+                    if (compare != Compare::eq && compare != Compare::ne) {
+                        throw std::invalid_argument("flat repository can't order component value");
+                    }
+                }
+            }
+
+            std::size_t size() const noexcept override {
+                return m_column->size();
+            }
+
+            std::size_t evaluate(std::size_t first, std::size_t last, std::uint32_t* out) const noexcept override {
+                auto const& v = m_value;
+                switch (m_compare) {
+                case Compare::eq:
+                case Compare::ne:
+                    if constexpr (detail::is_equality_comparable<T>::value) {
+                        if (m_compare == Compare::eq) {
+                            return scan(first, last, out, [&](T const& o) { return o == v; });
+                        }
+                        return scan(first, last, out, [&](T const& o) { return !(o == v); });
+                    }
+                    break;
+                default:
+                    if constexpr (detail::is_less_comparable<T>::value) {
+                        switch (m_compare) {
+                        case Compare::lt: return scan(first, last, out, [&](T const& o) { return o < v; });
+                        case Compare::le: return scan(first, last, out, [&](T const& o) { return !(v < o); });
+                        case Compare::gt: return scan(first, last, out, [&](T const& o) { return v < o; });
+                        case Compare::ge: return scan(first, last, out, [&](T const& o) { return !(o < v); });
+                        default: break;
+                        }
+                    }
+                    break;
+                }
+                return 0;
+            }
+        };
+
+        template<typename T>
+        inline std::unique_ptr<IPredicate> Column<T>::compile(Require const& req) const {
+            if (req.typeCode() != HashedTypeNameOf<T>()) {
+                throw std::invalid_argument("flat repository require type mismatch");
+            }
+            return std::make_unique<Predicate<T>>(this, req.as<T>(), compareOf(req));
+        }
+
+        //编译后的查询,可多次执行;为空时表示所有实体
+        class Query
+        {
+            friend class Repository;
+            std::shared_ptr<const IPredicate> m_predicate;
+        public:
+            Query() = default;
+            explicit Query(std::shared_ptr<const IPredicate> predicate)
+                :m_predicate(std::move(predicate)) {};
+
+            explicit operator bool() const noexcept {
+                return m_predicate != nullptr;
+            }
+        };
+
+        //实体标识符游标:按批求值,每批结果暂存在游标内,不分配实体包装
+        //遍历期间不能创建/销毁实体或增删数据组件
+        class Cursor
+        {
+        public:
+            static constexpr std::size_t batch_size = 256;
+        private:
+            Repository const* m_repo = nullptr;
+            std::shared_ptr<const IPredicate> m_predicate;
+            std::size_t m_position = 0;
+            std::size_t m_count = 0;
+            std::size_t m_offset = 0;
+            std::array<std::uint32_t, batch_size> m_batch;
+
+            bool fill() noexcept;
+        public:
+            Cursor() = default;
+            explicit Cursor(Repository const* repo, std::shared_ptr<const IPredicate> predicate) noexcept
+                :m_repo(repo), m_predicate(std::move(predicate)) {};
+
+            //取下一个实体标识符,结束时返回false
+            bool next(long long& key) noexcept;
+
+            class iterator
+            {
+                Cursor* m_cursor = nullptr;
+                long long m_key = -1;
+            public:
+                using difference_type = std::ptrdiff_t;
+                using value_type = long long;
+                using pointer = const long long*;
+                using reference = const long long&;
+                using iterator_category = std::input_iterator_tag;
+
+                iterator() = default;
+                explicit iterator(Cursor* cursor) noexcept
+                    :m_cursor(cursor)
+                {
+                    ++(*this);
+                }
+
+                reference operator*() const noexcept { return m_key; }
+
+                iterator& operator++() noexcept {
+                    if (m_cursor && !m_cursor->next(m_key)) {
+                        m_cursor = nullptr;
+                    }
+                    return *this;
+                }
+
+                bool operator==(iterator const& rhs) const noexcept { return m_cursor == rhs.m_cursor; }
+                bool operator!=(iterator const& rhs) const noexcept { return m_cursor != rhs.m_cursor; }
+            };
+
+            iterator begin() noexcept { return iterator{ this }; }
+            iterator end() noexcept { return iterator{}; }
+        };
+
+        //实体实现:数据组件接口就地构造,数量不超过inline_capacity时无需额外分配
+        class EntityImpl :public IEntity
+        {
+        public:
+            static constexpr std::size_t inline_capacity = 4;
+        private:
+            struct Slot {
+                alignas(Component<char>) unsigned char buffer[sizeof(Component<char>)];
+            };
+
+            long long m_key = -1;
+            std::size_t m_count = 0;
+            std::array<Slot, inline_capacity> m_inline;
+            std::array<IComponentBase*, inline_capacity> m_inlineHandles{};
+            std::unique_ptr<Slot[]> m_overflow;
+            std::unique_ptr<IComponentBase*[]> m_overflowHandles;
+
+            IComponentBase** handles() noexcept {
+                return m_overflowHandles ? m_overflowHandles.get() : m_inlineHandles.data();
+            }
+        public:
+            //不使用默认构造,避免实体集合值初始化时清零槽位
+            EntityImpl() noexcept {};
+            EntityImpl(EntityImpl const&) = delete;
+            EntityImpl& operator=(EntityImpl const&) = delete;
+            ~EntityImpl() {
+                reset();
+            }
+
+            void bind(Repository const* repo, long long key, IColumn* const* columns, std::size_t n) {
+                reset();
+                Slot* slots = m_inline.data();
+                if (n > inline_capacity) {
+                    m_overflow = std::make_unique<Slot[]>(n);
+                    m_overflowHandles = std::make_unique<IComponentBase*[]>(n);
+                    slots = m_overflow.get();
+                }
+                auto results = handles();
+                for (std::size_t i = 0; i < n; i++) {
+                    results[i] = columns[i]->construct(slots[i].buffer, repo, key);
+                }
+                m_count = n;
+                m_key = key;
+            }
+
+            void reset() noexcept {
+                auto results = handles();
+                for (std::size_t i = 0; i < m_count; i++) {
+                    results[i]->~IComponentBase();
+                }
+                m_count = 0;
+                m_key = -1;
+                m_overflow.reset();
+                m_overflowHandles.reset();
+            }
+
+            long long key() const noexcept {
+                return m_key;
+            }
+
+            HashedStringLiteral implTypeCode() const noexcept  override {
+                return HashedTypeNameOf<EntityImpl>();
+            }
+
+            IComponentBase* component(HashedStringLiteral typeCode) noexcept override {
+                auto results = handles();
+                for (std::size_t i = 0; i < m_count; i++) {
+                    if (results[i]->typeCode() == typeCode) {
+                        return results[i];
+                    }
+                }
+                return nullptr;
+            }
+
+            explicit operator bool() const noexcept {
+                return (m_key != -1) && (m_count != 0);
+            }
+        };
+
+        //实体集合实现:所有实体一次分配
+        class EntitysImpl :public IEntitys
+        {
+            std::unique_ptr<EntityImpl[]> m_entitys;
+            std::size_t m_size = 0;
+        public:
+            explicit EntitysImpl(std::size_t n)
+                :m_entitys(std::make_unique<EntityImpl[]>(n)), m_size(n) {};
+
+            HashedStringLiteral implTypeCode() const noexcept override {
+                return HashedTypeNameOf<EntitysImpl>();
+            }
+
+            std::size_t size() const noexcept {
+                return m_size;
+            }
+
+            EntityImpl& at(std::size_t i) noexcept {
+                return m_entitys[i];
+            }
+
+            std::vector<IEntity*> entitys() noexcept override {
+                std::vector<IEntity*> results;
+                results.reserve(m_size);
+                for (std::size_t i = 0; i < m_size; i++) {
+                    results.emplace_back(&m_entitys[i]);
+                }
+                return results;
+            }
+        };
+
+        class Repository :public IRepository
+        {
+            //槽位代数,奇数表示实体有效
+            std::vector<std::uint32_t> m_generations;
+            std::vector<std::uint32_t> m_frees;
+            std::size_t m_count = 0;
+            std::vector<std::pair<HashedStringLiteral, std::unique_ptr<IColumn>>> m_columns;
+        public:
+            Repository() = default;
+
+            template<typename T>
+            void registerComponentRepo() {
+                auto typeCode = HashedTypeNameOf<T>();
+                for (auto& o : m_columns) {
+                    if (o.first == typeCode) return;
+                }
+                m_columns.emplace_back(typeCode, std::make_unique<Column<T>>());
+            }
+
+            template<typename T>
+            Column<T>* columnOf() const noexcept {
+                return static_cast<Column<T>*>(findColumn(HashedTypeNameOf<T>()));
+            }
+
+            HashedStringLiteral implTypeCode() const  noexcept override {
+                return HashedTypeNameOf<Repository>();
+            }
+
+            std::size_t size() const noexcept {
+                return m_count;
+            }
+
+            static std::uint32_t indexOf(long long key) noexcept {
+                return static_cast<std::uint32_t>(static_cast<unsigned long long>(key) & 0xFFFFFFFFull);
+            }
+
+            static std::uint32_t generationOf(long long key) noexcept {
+                return static_cast<std::uint32_t>(static_cast<unsigned long long>(key) >> 32);
+            }
+
+            bool alive(long long key) const noexcept {
+                auto index = indexOf(key);
+                return index < m_generations.size() && m_generations[index] == generationOf(key) && (m_generations[index] & 1u) != 0;
+            }
+
+            //按实体标识符直接访问数据组件值,不存在时返回nullptr
+            template<typename T>
+            const T* view(long long key) const noexcept {
+                auto column = columnOf<T>();
+                return (column != nullptr && alive(key)) ? column->at(indexOf(key)) : nullptr;
+            }
+
+            //将针对数据组件T的要求编译为查询,可重复执行
+            template<typename T>
+            Query compile(Require const& req) const {
+                auto column = columnOf<T>();
+                if (column == nullptr) {
+                    throw std::invalid_argument("flat repository component not registered");
+                }
+                return Query{ column->compile(req) };
+            }
+
+            //执行查询,返回实体标识符游标
+            Cursor select(Query const& query = {}) const noexcept {
+                return Cursor{ this, query.m_predicate };
+            }
+
+            //遍历存活实体的槽位,一批写入out(容量不小于last-first),返回写入数量
+            std::size_t evaluate(std::size_t first, std::size_t last, std::uint32_t* out) const noexcept {
+                std::size_t n = 0;
+                for (auto i = first; i < last; i++) {
+                    out[n] = static_cast<std::uint32_t>(i);
+                    n += (m_generations[i] & 1u);
+                }
+                return n;
+            }
+
+            std::size_t slots() const noexcept {
+                return m_generations.size();
+            }
+
+            long long keyOf(std::uint32_t index) const noexcept {
+                return static_cast<long long>((static_cast<unsigned long long>(m_generations[index]) << 32) | index);
+            }
+        private:
+            IColumn* findColumn(HashedStringLiteral typeCode) const noexcept {
+                for (auto& o : m_columns) {
+                    if (o.first == typeCode) {
+                        return o.second.get();
+                    }
+                }
+                return nullptr;
+            }
+
+            IColumn* columnOf(HashedStringLiteral typeCode) const {
+                if (auto result = findColumn(typeCode)) {
+                    return result;
+                }
+                throw std::invalid_argument("flat repository component not registered");
+            }
+
+            //按批执行要求,满足条件的槽位索引交给fn,fn返回false时停止
+            template<typename F>
+            void match(Require const& req, F&& fn) const {
+                auto predicate = columnOf(req.typeCode())->compile(req);
+                std::array<std::uint32_t, Cursor::batch_size> batch;
+                auto n = predicate->size();
+                for (std::size_t first = 0; first < n; first += batch.size()) {
+                    auto count = predicate->evaluate(first, std::min(n, first + batch.size()), batch.data());
+                    for (std::size_t i = 0; i < count; i++) {
+                        if (!fn(batch[i])) return;
+                    }
+                }
+            }
+
+            std::vector<std::uint32_t> matchAll(Require const& req) const {
+                std::vector<std::uint32_t> results;
+                match(req, [&](std::uint32_t index) {
+                    results.emplace_back(index);
+                    return true;
+                    });
+                return results;
+            }
+
+            //将类型对应的列解析到连续数组上,数量较少时不分配
+            template<typename F>
+            void withColumns(TypeCodes typeCodes, F&& fn) const {
+                std::array<IColumn*, EntityImpl::inline_capacity> local{};
+                std::vector<IColumn*> overflow;
+                IColumn** columns = local.data();
+                if (typeCodes.size() > local.size()) {
+                    overflow.resize(typeCodes.size());
+                    columns = overflow.data();
+                }
+                std::size_t i = 0;
+                typeCodes.visit([&](HashedStringLiteral typeCode) {
+                    columns[i++] = columnOf(typeCode);
+                    });
+                fn(columns, typeCodes.size());
+            }
+
+            std::unique_ptr<IEntity> entityOf(TypeCodes typeCodes, long long key) const {
+                auto result = std::make_unique<EntityImpl>();
+                withColumns(typeCodes, [&](IColumn* const* columns, std::size_t n) {
+                    result->bind(this, key, columns, n);
+                    });
+                return result;
+            }
+
+            std::unique_ptr<IEntitys> entitysOf(TypeCodes typeCodes, std::vector<std::uint32_t> const& indexs) const {
+                auto result = std::make_unique<EntitysImpl>(indexs.size());
+                withColumns(typeCodes, [&](IColumn* const* columns, std::size_t n) {
+                    for (std::size_t i = 0; i < indexs.size(); i++) {
+                        result->at(i).bind(this, keyOf(indexs[i]), columns, n);
+                    }
+                    });
+                return result;
+            }
+
+            std::uint32_t allocate() {
+                ++m_count;
+                if (!m_frees.empty()) {
+                    auto index = m_frees.back();
+                    m_frees.pop_back();
+                    m_generations[index]++;
+                    return index;
+                }
+                m_generations.emplace_back(1u);
+                return static_cast<std::uint32_t>(m_generations.size() - 1);
+            }
+
+            std::size_t release(std::uint32_t index) noexcept {
+                if (index >= m_generations.size() || (m_generations[index] & 1u) == 0) return 0;
+                for (auto& o : m_columns) {
+                    o.second->erase(index);
+                }
+                m_generations[index]++;
+                m_frees.emplace_back(index);
+                --m_count;
+                return 1;
+            }
+
+            std::size_t release(long long key) noexcept {
+                return alive(key) ? release(indexOf(key)) : 0;
+            }
+
+            std::size_t releaseAll() noexcept {
+                auto n = m_count;
+                for (auto& o : m_columns) {
+                    o.second->clear();
+                }
+                m_frees.clear();
+                for (std::size_t i = m_generations.size(); i > 0; i--) {
+                    auto& generation = m_generations[i - 1];
+                    generation += (generation & 1u);
+                    m_frees.emplace_back(static_cast<std::uint32_t>(i - 1));
+                }
+                m_count = 0;
+                return n;
+            }
+
+            std::vector<std::uint32_t> aliveIndexs() const {
+                std::vector<std::uint32_t> results;
+                results.reserve(m_count);
+                for (std::size_t i = 0; i < m_generations.size(); i++) {
+                    if ((m_generations[i] & 1u) != 0) {
+                        results.emplace_back(static_cast<std::uint32_t>(i));
+                    }
+                }
+                return results;
+            }
+        protected:
+            std::unique_ptr<IEntity> createImpl(TypeCodes typeCodes, Value const& argument)  override {
+                if (argument) {
+                    if (!typeCodes.has(argument.typeCode())) {
+                        throw std::invalid_argument("flat repository cann't process create argument");
+                    }
+                }
+                auto result = std::make_unique<EntityImpl>();
+                withColumns(typeCodes, [&](IColumn* const* columns, std::size_t n) {
+                    auto index = allocate();
+                    result->bind(this, keyOf(index), columns, n);
+                    //如果有参数则写入
+                    if (argument) {
+                        columnOf(argument.typeCode())->write(index, argument);
+                    }
+                    });
+                return result;
+            }
+
+            std::size_t destoryImpl(TypeCodes typeCodes, Require const& req)  override {
+                auto reqTypeCode = req.typeCode();
+                if (reqTypeCode == HashedTypeNameOf<long long>()) {
+                    auto key = req.as<long long>();
+                    auto remark = req.remark(""_hashed);
+                    if (remark == "=="_hashed) {
+                        return release(key);
+                    }
+                    else if (remark == "!="_hashed) {
+                        std::size_t n = 0;
+                        for (auto index : aliveIndexs()) {
+                            if (keyOf(index) != key) {
+                                n += release(index);
+                            }
+                        }
+                        return n;
+                    }
+                }
+                else if (!reqTypeCode)//默认不传条件就是清空
+                {
+                    return releaseAll();
+                }
+                else if (typeCodes.has(reqTypeCode)) {
+                    //先收集再销毁,销毁会改变列中值的位置
+                    std::size_t n = 0;
+                    for (auto index : matchAll(req)) {
+                        n += release(index);
+                    }
+                    return n;
+                }
+                throw std::invalid_argument("flat repository can't process destory require");
+            }
+
+            std::size_t destoryImpl(TypeCodes typeCodes, std::unique_ptr<IEntity>&& entity) noexcept override {
+                if (entity && entity->implTypeCode() == HashedTypeNameOf<EntityImpl>()) {
+                    return release(static_cast<EntityImpl*>(entity.get())->key());
+                }
+                return 0;
+            }
+
+            std::size_t destoryImpl(TypeCodes typeCodes, std::unique_ptr<IEntitys>&& entitys) noexcept override {
+                if (entitys && entitys->implTypeCode() == HashedTypeNameOf<EntitysImpl>()) {
+                    auto impl = static_cast<EntitysImpl*>(entitys.get());
+                    std::size_t n = 0;
+                    for (std::size_t i = 0; i < impl->size(); i++) {
+                        n += release(impl->at(i).key());
+                    }
+                    return n;
+                }
+                return 0;
+            }
+
+            std::unique_ptr<IEntity> findImpl(TypeCodes typeCodes, Require const& req) const override {
+                if (m_count == 0) return nullptr;
+                auto reqTypeCode = req.typeCode();
+                if (reqTypeCode == HashedTypeNameOf<long long>()) {
+                    auto key = req.as<long long>();
+                    if (!alive(key)) return nullptr;
+                    return entityOf(typeCodes, key);
+                }
+                else if (typeCodes.has(reqTypeCode)) {
+                    std::unique_ptr<IEntity> result;
+                    match(req, [&](std::uint32_t index) {
+                        result = entityOf(typeCodes, keyOf(index));
+                        return false;
+                        });
+                    return result;
+                }
+                throw std::invalid_argument("flat repository can't process find require");
+            }
+
+            std::unique_ptr<IEntitys> searchImpl(TypeCodes typeCodes, Require const& req) const override {
+                auto reqTypeCode = req.typeCode();
+                if (!reqTypeCode) {
+                    return entitysOf(typeCodes, aliveIndexs());
+                }
+                else if (typeCodes.has(reqTypeCode)) {
+                    return entitysOf(typeCodes, matchAll(req));
+                }
+                throw std::invalid_argument("flat repository can't process search require");
+            }
+        };
+
+        inline bool Cursor::fill() noexcept {
+            m_offset = 0;
+            m_count = 0;
+            auto n = m_predicate ? m_predicate->size() : m_repo->slots();
+            while (m_count == 0 && m_position < n) {
+                auto last = std::min(n, m_position + batch_size);
+                m_count = m_predicate ? m_predicate->evaluate(m_position, last, m_batch.data())
+                    : m_repo->evaluate(m_position, last, m_batch.data());
+                m_position = last;
+            }
+            return m_count != 0;
+        }
+
+        inline bool Cursor::next(long long& key) noexcept {
+            if (m_repo == nullptr) return false;
+            if (m_offset == m_count && !fill()) return false;
+            key = m_repo->keyOf(m_batch[m_offset++]);
+            return true;
+        }
+
+        template<typename T>
+        inline IComponentBase* Column<T>::construct(void* buffer, Repository const* repo, long long key) noexcept {
+            static_assert(sizeof(Component<T>) == sizeof(Component<char>), "component layout must not depend on T");
+            return ::new (buffer) Component<T>(this, repo, key);
+        }
+
+        template<typename T>
+        inline bool Component<T>::exist() const noexcept {
+            return m_repo->alive(m_key) && m_column->contains(Repository::indexOf(m_key));
+        }
+
+        template<typename T>
+        inline T Component<T>::view() const {
+            if (!exist()) {
+                throw std::out_of_range("flat repository component not exist");
+            }
+            return *m_column->at(Repository::indexOf(m_key));
+        }
+
+        template<typename T>
+        inline bool Component<T>::remove() noexcept {
+            if (!exist()) return false;
+            m_column->erase(Repository::indexOf(m_key));
+            return true;
+        }
+
+        template<typename T>
+        inline bool Component<T>::assign(T const& v) noexcept {
+            if (!m_repo->alive(m_key)) return false;
+            return m_column->assign(Repository::indexOf(m_key), v);
+        }
+
+        template<typename T>
+        inline T Component<T>::replace(T const& v) noexcept {
+            if (!exist()) return v;
+            return std::exchange(*m_column->at(Repository::indexOf(m_key)), v);
+        }
+    }
+}
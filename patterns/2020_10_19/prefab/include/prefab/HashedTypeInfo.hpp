@@ -69,6 +69,18 @@ namespace prefab
         }
 
         struct SearchTypeWarpTag {};
+        struct SearchTypePrettyTag {};
+
+        //__PRETTY_FUNCTION__形如"... [with T = int; ...]"或"... [T = int]"
+        template<std::size_t N>
+        inline constexpr std::size_t find_pretty_type_begin(const char(&s)[N], std::size_t i = 0) {
+            return (s[i] == 'T' && s[i + 1] == ' ' && s[i + 2] == '=' && s[i + 3] == ' ') ? i + 4 : find_pretty_type_begin(s, i + 1);
+        }
+
+        template<std::size_t N>
+        inline constexpr std::size_t find_pretty_type_end(const char(&s)[N], std::size_t i) {
+            return (s[i] == ';' || i + 2 >= N) ? i : find_pretty_type_end(s, i + 1);
+        }
 
         template<typename T>
         class hashed_string_literal {
@@ -95,6 +107,12 @@ namespace prefab
                 size_{ N - 1 - detail::find_left_bracket(s) - detail::find_right_bracket(s) },
                 hash_{ fnv1a_hash<std::size_t>(size_, data_) }{};
 
+            template<std::size_t N>
+            constexpr hashed_string_literal(SearchTypePrettyTag, const char(&s)[N]) noexcept
+                :data_{ s + detail::find_pretty_type_begin(s) },
+                size_{ detail::find_pretty_type_end(s, detail::find_pretty_type_begin(s)) - detail::find_pretty_type_begin(s) },
+                hash_{ fnv1a_hash<std::size_t>(size_, data_) }{};
+
             constexpr std::size_t size()  const noexcept { return size_; };
             constexpr std::size_t length() const noexcept { return size_; };
             constexpr bool empty() const noexcept { return 0 == size_; };
@@ -159,7 +177,11 @@ namespace prefab
     constexpr prefab::HashedStringLiteral HashedTypeNameOf() {
         //class prefab::HashedStringLiteral __cdecl prefab::HashedTypeNameOf<int>(void)
         //return { __FUNCSIG__,sizeof("class prefab::HashedStringLiteral __cdecl prefab::HashedTypeNameOf<")-1,sizeof(">(void)")-1 };
+#if defined(_MSC_VER) && !defined(__clang__)
         return { detail::SearchTypeWarpTag{},__FUNCSIG__ };
+#else
+        return { detail::SearchTypePrettyTag{},__PRETTY_FUNCTION__ };
+#endif
     }
 
     template<typename T>
@@ -132,7 +132,7 @@ namespace prefab
     public:
         Entity() = default;
         explicit Entity(std::unique_ptr<IEntity>&& entity)
-            :EntityView(entity.get()), m_impl(std::move(entity))
+            :EntityView<Ts...>(entity.get()), m_impl(std::move(entity))
         {};
     };
 
@@ -37,7 +37,7 @@ namespace prefab
             }
 
             template<typename F>
-            void visit(F& fn) const {
+            void visit(F&& fn) const {
                 for (std::size_t i = 0; i < n; i++) {
                     fn(*(pointer + i));
                 }
@@ -79,13 +79,13 @@ namespace prefab
         template<typename... Ts>
         std::size_t destory(Entity<Ts...>&& entity) noexcept {
             auto typeCodes = typeCodesOf<Ts...>();
-            return destoryImpl(typeCodes, entity.m_impl);
+            return destoryImpl(typeCodes, std::move(entity.m_impl));
         }
 
         template<typename... Ts>
         std::size_t destory(Entitys<Ts...>&& entitys) noexcept {
             auto typeCodes = typeCodesOf<Ts...>();
-            return destoryImpl(typeCodes, entitys.m_impl);
+            return destoryImpl(typeCodes, std::move(entitys.m_impl));
         }
 
         template<typename... Ts>
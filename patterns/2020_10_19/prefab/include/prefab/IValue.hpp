@@ -57,7 +57,7 @@ namespace prefab
         }
         
         HashedStringLiteral typeCode() const noexcept {
-            return impl->typeCode();
+            return impl ? impl->typeCode() : HashedStringLiteral{};
         }
 
         template<typename T>
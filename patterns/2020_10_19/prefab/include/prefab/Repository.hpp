@@ -236,10 +236,14 @@ namespace prefab
                 }
                 else if (typeCodes.has(reqTypeCode)) {
                     std::size_t n = 0;
-                    auto fn = m_componentHandlers.at(reqTypeCode);
-                    for (auto key : m_idRepo) {
-                        if (fn(this, key, req)) {
-                            n += m_idRepo.erase(key);
+                    auto& fn = m_componentHandlers.at(reqTypeCode);
+                    for (auto it = m_idRepo.begin(); it != m_idRepo.end();) {
+                        if (fn(this, *it, req)) {
+                            it = m_idRepo.erase(it);
+                            n++;
+                        }
+                        else {
+                            ++it;
                         }
                     }
                     return n;
@@ -1,8 +1,10 @@
 ﻿#pragma once
 //TODO inject函数可以接收类型成员函数指针,以此来支持用户自由定义成员
+#include <cstdint>
 #include <type_traits>
 #include <memory>
 #include <vector>
+#include <unordered_map>
 
 namespace abc
 {
@@ -182,6 +184,28 @@ namespace abc
             void run(const Arg& arg) {
                 return runImpl(Payload(arg));
             }
+
+            /// @brief 响应函数入口:类型标识符及其在响应函数中的索引,供分发器建立索引
+            struct Entry {
+                TypeCode    code;
+                std::size_t index;
+            };
+
+            /// @brief 响应函数是否无状态:结果只依赖于参数,可以并发执行
+            /// @return 是否无状态
+            virtual bool isStateless() const noexcept { return false; }
+
+            /// @brief 获取响应函数支持的入口列表,未提供入口的响应函数每次分发都会执行
+            /// @return 入口列表
+            virtual std::vector<Entry> entries() const { return {}; }
+
+            /// @brief 执行指定索引的入口,跳过类型标识符匹配
+            /// @param index 入口索引
+            /// @param payload 负载
+            virtual void runAt(std::size_t index, Payload payload) {
+                (void)index;
+                return runImpl(payload);
+            }
         protected:
             virtual void runImpl(Payload payload) = 0;
         };
@@ -197,6 +221,7 @@ namespace abc
                 void(*cb)(T*, Payload);
             };
             std::vector<Callback> m_callbacks;
+            bool m_stateless{ false };
 
             void runImpl(Payload payload) override {
                 for (auto& obj : m_callbacks) {
@@ -206,6 +231,23 @@ namespace abc
                     return;
                 }
             }
+        public:
+            bool isStateless() const noexcept override {
+                return m_stateless;
+            }
+
+            std::vector<IHandler::Entry> entries() const override {
+                std::vector<IHandler::Entry> results;
+                results.reserve(m_callbacks.size());
+                for (std::size_t i = 0; i < m_callbacks.size(); i++) {
+                    results.emplace_back(IHandler::Entry{ m_callbacks[i].code,i });
+                }
+                return results;
+            }
+
+            void runAt(std::size_t index, Payload payload) override {
+                m_callbacks[index].cb(static_cast<T*>(this), payload);
+            }
         };
 
         /// @brief 仿函数版本的响应函数,使用inject可以注册多个不同参数的响应函数
@@ -213,18 +255,26 @@ namespace abc
         template<typename T>
         class CallableHandler final :public Handler<CallableHandler<T>>
         {
+            using Callback = typename Handler<CallableHandler<T>>::Callback;
             T m_obj;
         public:
             explicit CallableHandler(T v)
                 :m_obj(std::move(v)) {};
 
+            /// @brief 声明为无状态响应函数,回放校验时可以并发执行
+            /// @return 
+            CallableHandler& markStateless() {
+                this->m_stateless = true;
+                return *this;
+            }
+
             /// @brief 带结果写入的响应函数注入
             /// @tparam Arg 响应函数的参数
             /// @tparam R 响应函数执行的结果
             /// @return 
             template<typename Arg, typename R>
             CallableHandler& inject() {
-                m_callbacks.emplace_back(Callback{ TypeCodeOf<Arg,R>(),
+                this->m_callbacks.emplace_back(Callback{ TypeCodeOf<Arg,R>(),
                     [](CallableHandler* obj,Payload o) {
                         obj->m_obj(*static_cast<const Arg*>(o.arg),
                             *static_cast<R*>(o.result));
@@ -234,7 +284,7 @@ namespace abc
 
             template<typename Arg>
             CallableHandler& inject() {
-                m_callbacks.emplace_back(Callback{ TypeCodeOf<Arg>(),
+                this->m_callbacks.emplace_back(Callback{ TypeCodeOf<Arg>(),
                     [](CallableHandler* obj,Payload o) {
                         obj->m_obj(*static_cast<const Arg*>(o.arg));
                     } });
@@ -247,18 +297,26 @@ namespace abc
         template<typename T>
         class DispatchHandler final :public Handler<DispatchHandler<T>>
         {
+            using Callback = typename Handler<DispatchHandler<T>>::Callback;
             T m_obj;
         public:
             explicit DispatchHandler(T v)
                 :m_obj(std::move(v)) {};
 
+            /// @brief 声明为无状态响应函数,回放校验时可以并发执行
+            /// @return 
+            DispatchHandler& markStateless() {
+                this->m_stateless = true;
+                return *this;
+            }
+
             /// @brief 带结果写入的响应函数注入
             /// @tparam Arg 响应函数的参数
             /// @tparam R 响应函数执行的结果
             /// @return 
             template<typename Arg, typename R>
             DispatchHandler& inject() {
-                m_callbacks.emplace_back(Callback{ TypeCodeOf<Arg,R>(),
+                this->m_callbacks.emplace_back(Callback{ TypeCodeOf<Arg,R>(),
                     [](DispatchHandler* obj,Payload o) {
                         obj->m_obj.on(*static_cast<const Arg*>(o.arg),*static_cast<R*>(o.result));
                     } });
@@ -267,7 +325,7 @@ namespace abc
 
             template<typename Arg>
             DispatchHandler& inject() {
-                m_callbacks.emplace_back(Callback{ TypeCodeOf<Arg>(),
+                this->m_callbacks.emplace_back(Callback{ TypeCodeOf<Arg>(),
                     [](DispatchHandler* obj,Payload o) {
                         obj->m_obj.on(*static_cast<const Arg*>(o.arg));
                     } });
@@ -314,6 +372,10 @@ namespace abc
             virtual void exec(IHandler& op) = 0;
 
             virtual void write(IWriter& writer, IWriter::When when) const = 0;
+
+            /// @brief 获取动作对应的负载,供分发器按类型标识符直接执行
+            /// @return 负载,未提供时参数地址为空,分发器会以exec逐个执行响应函数
+            virtual Payload payload() { return Payload{}; }
         };
 
         /// @brief 动作实现:包含不变参数地址、可变结果地址
@@ -331,6 +393,9 @@ namespace abc
             void write(IWriter& writer, IWriter::When when) const override {
                 writer.push(Payload(*arg, *r),when);
             }
+            Payload payload() override {
+                return Payload(*arg, *r);
+            }
         };
 
         /// @brief 动作实现:没有结果的偏特化版本
@@ -346,6 +411,9 @@ namespace abc
             void write(IWriter& writer, IWriter::When when) const override {
                 writer.push(Payload(*arg),when);
             }
+            Payload payload() override {
+                return Payload(*arg);
+            }
         };
 
         /// @brief 支持回放的动作
@@ -371,6 +439,9 @@ namespace abc
             void write(IWriter& writer, IWriter::When when) const override {
                 writer.push(Payload(arg,actual),when);
             }
+            Payload payload() override {
+                return Payload(arg, actual);
+            }
 
             bool verify() const override {
                 return expect == actual;
@@ -388,6 +459,9 @@ namespace abc
             void write(IWriter& writer, IWriter::When when) const override {
                 writer.push(Payload(arg),when);
             }
+            Payload payload() override {
+                return Payload(arg);
+            }
 
             bool verify() const override { return true; }
         };
@@ -409,11 +483,19 @@ namespace abc
                 m_writer = writer;
             }
 
+            /// @brief 获取动作记录模块
+            /// @return 动作写入接口
+            std::shared_ptr<IWriter> writer() const noexcept {
+                return m_writer;
+            }
+
             /// @brief 注册动作响应函数
             /// @param handler 响应函数
             /// @return 响应函数副本
+            /// @note 注册时根据响应函数的入口建立分发索引,注册后再inject的入口不会被索引
             std::shared_ptr<IHandler> registerHandler(std::shared_ptr<IHandler>&& handler) noexcept {
                 m_handlers.emplace_back(std::move(handler));
+                index(m_handlers.back().get());
                 return m_handlers.back();
             }
 
@@ -425,6 +507,7 @@ namespace abc
             std::shared_ptr<IHandler> registerHandler(T&& v) noexcept {
                 static_assert(std::is_base_of<IHandler, std::decay_t<T>>::value, "should be base of IHandler");
                 m_handlers.emplace_back(std::make_shared<std::decay_t<T>>(std::forward<T>(v)));
+                index(m_handlers.back().get());
                 return m_handlers.back();
             }
 
@@ -435,7 +518,8 @@ namespace abc
             /// @param r 结果
             template<typename Arg, typename Result>
             void dispatch(const Arg& arg, Result& r) {
-                dispatchImpl(Action<Arg, Result>{arg, r});
+                Action<Arg, Result> action{ arg, r };
+                dispatchImpl(action);
             }
 
             template<typename Result, typename Arg>
@@ -450,32 +534,86 @@ namespace abc
             /// @param arg 参数
             template<typename Arg>
             void dispatch(const Arg& arg) {
-                dispatchImpl(Action<Arg, void>{arg});
+                Action<Arg, void> action{ arg };
+                dispatchImpl(action);
             }
 
             /// @brief 回放动作
             /// @param msg 
             void replay(IAction& action) {
-                auto handle = [&](auto& action) {
-                    for (auto& h : m_handlers) {
-                        action.exec(*h);
-                    }
-                };
-                if (m_writer) {
-                    action.write(*m_writer, IWriter::When::enter);
-                    handle(action);
-                    action.write(*m_writer, IWriter::When::leave);
+                dispatchImpl(action);
+            }
+
+            /// @brief 指定类型的动作是否只会由无状态响应函数处理
+            /// @param code 动作的类型标识符
+            /// @return 是否无状态
+            bool isStateless(TypeCode code) const noexcept {
+                for (auto& generic : m_generics) {
+                    if (!generic.handler->isStateless())
+                        return false;
                 }
-                else {
-                    handle(action);
+                auto it = m_routes.find(code.hash);
+                if (it == m_routes.end())
+                    return true;
+                for (auto& route : it->second) {
+                    if (!route.handler->isStateless())
+                        return false;
                 }
+                return true;
             }
         private:
-            template<typename Arg, typename R>
-            void dispatchImpl(Action<Arg, R>& action) {
-                auto handle = [&](auto& action) {
-                    for (auto& h : m_handlers) {
-                        action.exec(*h);
+            /// @brief 分发索引项:响应函数、其入口索引及注册顺序
+            struct Route {
+                IHandler* handler;
+                std::size_t index;
+                std::size_t order;
+            };
+
+            /// @brief 为响应函数建立分发索引,同一响应函数的相同类型标识符只索引首个入口
+            /// @param handler 响应函数
+            void index(IHandler* handler) {
+                auto order = m_handlers.size() - 1;
+                auto entries = handler->entries();
+                if (entries.empty()) {
+                    m_generics.emplace_back(Route{ handler,0,order });
+                    return;
+                }
+                for (auto& entry : entries) {
+                    auto& routes = m_routes[entry.code.hash];
+                    if (!routes.empty() && routes.back().handler == handler)
+                        continue;
+                    routes.emplace_back(Route{ handler,entry.index,order });
+                }
+            }
+
+            void dispatchImpl(IAction& action) {
+                auto handle = [&](IAction& action) {
+                    auto payload = action.payload();
+                    if (payload.arg == nullptr) {
+                        //动作未提供负载,按注册顺序执行全部响应函数
+                        for (auto& h : m_handlers) {
+                            action.exec(*h);
+                        }
+                        return;
+                    }
+                    //索引项与通用响应函数均按注册顺序排列,合并执行以保持注册顺序
+                    auto it = m_routes.find(payload.code.hash);
+                    const Route* route = nullptr;
+                    const Route* last = nullptr;
+                    if (it != m_routes.end()) {
+                        route = it->second.data();
+                        last = route + it->second.size();
+                    }
+                    auto generic = m_generics.begin();
+                    while (route != last || generic != m_generics.end()) {
+                        if (generic == m_generics.end() || (route != last && route->order < generic->order)) {
+                            route->handler->runAt(route->index, payload);
+                            ++route;
+                        }
+                        else {
+                            action.exec(*generic->handler);
+                            ++generic;
+                        }
                     }
                 };
                 if (m_writer) {
@@ -488,6 +626,8 @@ namespace abc
                 }
             }
             std::vector<std::shared_ptr<IHandler>> m_handlers;
+            std::unordered_map<std::size_t, std::vector<Route>> m_routes;
+            std::vector<Route> m_generics;
             std::shared_ptr<IWriter>  m_writer;
         };
     }
@@ -0,0 +1,158 @@
+﻿#include "JournalIO.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr std::size_t HeaderSize = sizeof(std::uint32_t) + sizeof(std::uint64_t);
+}
+
+bool JournalWriter::open(std::string const& filepath)
+{
+    close();
+    m_stream.open(filepath, std::ios::binary | std::ios::app);
+    return m_stream.is_open();
+}
+
+void JournalWriter::close()
+{
+    if (m_stream.is_open()) {
+        m_stream.close();
+    }
+    m_count = 0;
+}
+
+void JournalWriter::push(const abc::Payload& o, abc::IWriter::When when)
+{
+    //与JsonWriter一致,只记录离开的时候
+    if (when != abc::IWriter::When::leave || !m_stream)
+        return;
+    auto it = m_writers.find(o.code.hash);
+    if (it == m_writers.end() || !it->second)
+        return;
+
+    //复用缓冲区,预留记录头后写入负载,再回填长度
+    m_buffer.assign(HeaderSize, '\0');
+    it->second(m_buffer, o);
+
+    std::uint32_t size = static_cast<std::uint32_t>(m_buffer.size() - sizeof(std::uint32_t));
+    std::uint64_t hash = static_cast<std::uint64_t>(o.code.hash);
+    std::memcpy(&m_buffer[0], &size, sizeof(size));
+    std::memcpy(&m_buffer[sizeof(size)], &hash, sizeof(hash));
+    m_stream.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_count++;
+}
+
+JournalReader::~JournalReader()
+{
+    close();
+}
+
+bool JournalReader::open(std::string const& filepath)
+{
+    close();
+#ifdef _WIN32
+    auto file = ::CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size{};
+    if (!::GetFileSizeEx(file, &size)) {
+        ::CloseHandle(file);
+        return false;
+    }
+    if (size.QuadPart == 0) {
+        ::CloseHandle(file);
+        return true;
+    }
+    auto mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        ::CloseHandle(file);
+        return false;
+    }
+    auto view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        ::CloseHandle(mapping);
+        ::CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_mapping = mapping;
+    m_first = static_cast<const char*>(view);
+    m_last = m_first + size.QuadPart;
+#else
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        ::close(fd);
+        return true;
+    }
+    auto view = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED)
+        return false;
+    ::madvise(view, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+    m_size = static_cast<std::size_t>(st.st_size);
+    m_first = static_cast<const char*>(view);
+    m_last = m_first + m_size;
+#endif
+    m_current = m_first;
+    return true;
+}
+
+void JournalReader::close()
+{
+    if (m_first) {
+#ifdef _WIN32
+        ::UnmapViewOfFile(m_first);
+        ::CloseHandle(m_mapping);
+        ::CloseHandle(m_file);
+        m_file = nullptr;
+        m_mapping = nullptr;
+#else
+        ::munmap(const_cast<char*>(m_first), m_size);
+        m_size = 0;
+#endif
+    }
+    m_first = m_last = m_current = nullptr;
+}
+
+std::unique_ptr<abc::IReplayAction> JournalReader::next()
+{
+    while (m_current && static_cast<std::size_t>(m_last - m_current) >= HeaderSize) {
+        std::uint32_t size{};
+        std::uint64_t hash{};
+        std::memcpy(&size, m_current, sizeof(size));
+        std::memcpy(&hash, m_current + sizeof(size), sizeof(hash));
+        auto first = m_current + HeaderSize;
+        auto last = m_current + sizeof(size) + size;
+        if (size < sizeof(hash) || last > m_last)
+            break;
+        m_current = last;
+
+        auto it = m_readers.find(static_cast<std::size_t>(hash));
+        if (it == m_readers.end() || !it->second)
+            continue;
+        if (auto r = it->second(first, last)) {
+            return r;
+        }
+    }
+    m_current = m_last;
+    return nullptr;
+}
@@ -0,0 +1,133 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include "Broker.hpp"
+
+/// @brief 二进制动作日志的序列化实现,默认支持可平凡复制类型,其它类型需要特化
+/// @tparam T 参数/结果类型
+template<typename T, typename = void>
+struct JournalCodec;
+
+template<typename T>
+struct JournalCodec<T, std::enable_if_t<std::is_trivially_copyable_v<T>>>
+{
+    static void write(std::string& buffer, T const& v) {
+        buffer.append(reinterpret_cast<const char*>(std::addressof(v)), sizeof(T));
+    }
+
+    static bool read(const char*& first, const char* last, T& v) {
+        if (static_cast<std::size_t>(last - first) < sizeof(T))
+            return false;
+        std::memcpy(std::addressof(v), first, sizeof(T));
+        first += sizeof(T);
+        return true;
+    }
+};
+
+/// @brief 二进制动作日志写入:动作完成后立即以定长头+负载的记录追加到文件
+///
+/// 记录格式(本机字节序):
+/// | uint32 记录长度 | uint64 类型标识符哈希 | 参数 | 结果(可选) |
+class JournalWriter :public abc::IWriter
+{
+public:
+    using Writer = std::function<void(std::string&, abc::Payload const&)>;
+public:
+    JournalWriter() = default;
+
+    /// @brief 打开日志文件,已有内容会被保留,新记录追加到末尾
+    /// @param filepath 文件路径
+    /// @return 是否成功
+    bool open(std::string const& filepath);
+
+    void close();
+
+    template<typename Arg, typename R>
+    void registerWriter() {
+        m_writers[abc::TypeCodeOf<Arg, R>().hash] = [](std::string& buffer, const abc::Payload& o) {
+            JournalCodec<Arg>::write(buffer, *static_cast<const Arg*>(o.arg));
+            JournalCodec<R>::write(buffer, *static_cast<const R*>(o.result));
+        };
+    }
+
+    template<typename Arg>
+    void registerWriter() {
+        m_writers[abc::TypeCodeOf<Arg>().hash] = [](std::string& buffer, const abc::Payload& o) {
+            JournalCodec<Arg>::write(buffer, *static_cast<const Arg*>(o.arg));
+        };
+    }
+
+    void push(const abc::Payload& o, abc::IWriter::When when) override;
+
+    /// @brief 已写入的记录数
+    std::size_t count() const noexcept {
+        return m_count;
+    }
+private:
+    std::unordered_map<std::size_t, Writer> m_writers;
+    std::ofstream m_stream;
+    std::string   m_buffer;
+    std::size_t   m_count{ 0 };
+};
+
+/// @brief 二进制动作日志读取:以内存映射方式打开日志文件,逐条生成回放动作
+class JournalReader
+{
+public:
+    using Reader = std::function<std::unique_ptr<abc::IReplayAction>(const char*, const char*)>;
+public:
+    JournalReader() = default;
+    ~JournalReader();
+
+    JournalReader(JournalReader const&) = delete;
+    JournalReader& operator=(JournalReader const&) = delete;
+
+    template<typename Arg, typename R>
+    void registerReader() {
+        m_readers[abc::TypeCodeOf<Arg, R>().hash] = [](const char* first, const char* last)->std::unique_ptr<abc::IReplayAction> {
+            auto result = std::make_unique<abc::ReplayAction<Arg, R>>();
+            if (!JournalCodec<Arg>::read(first, last, result->arg) ||
+                !JournalCodec<R>::read(first, last, result->expect))
+                return nullptr;
+            return result;
+        };
+    }
+
+    template<typename Arg>
+    void registerReader() {
+        m_readers[abc::TypeCodeOf<Arg>().hash] = [](const char* first, const char* last)->std::unique_ptr<abc::IReplayAction> {
+            auto result = std::make_unique<abc::ReplayAction<Arg, void>>();
+            if (!JournalCodec<Arg>::read(first, last, result->arg))
+                return nullptr;
+            return result;
+        };
+    }
+
+    /// @brief 映射日志文件,并将读取位置重置到开头
+    /// @param filepath 文件路径
+    /// @return 是否成功
+    bool open(std::string const& filepath);
+
+    void close();
+
+    /// @brief 读取下一个可回放的动作,未注册读取实现的记录会被跳过
+    /// @return 动作,读取完成或日志损坏时返回空
+    std::unique_ptr<abc::IReplayAction> next();
+private:
+    std::unordered_map<std::size_t, Reader> m_readers;
+    const char* m_first{ nullptr };
+    const char* m_last{ nullptr };
+    const char* m_current{ nullptr };
+#ifdef _WIN32
+    void* m_file{ nullptr };
+    void* m_mapping{ nullptr };
+#else
+    std::size_t m_size{ 0 };
+#endif
+};
@@ -0,0 +1,125 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <thread>
+#include "Broker.hpp"
+
+namespace abc
+{
+    inline namespace v1
+    {
+        /// @brief 回放校验结果
+        struct ReplayReport {
+            static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+            std::size_t total{ 0 };         //动作数
+            std::size_t concurrent{ 0 };    //并发执行的动作数
+            std::size_t failed{ 0 };        //校验失败的动作数
+            std::size_t firstDiverged{ npos };//首个校验失败的动作索引
+            double      seconds{ 0.0 };     //耗时
+
+            /// @brief 每秒回放的动作数
+            double throughput() const noexcept {
+                return seconds > 0.0 ? static_cast<double>(total) / seconds : 0.0;
+            }
+
+            bool succeed() const noexcept {
+                return failed == 0;
+            }
+        };
+
+        /// @brief 并发回放并校验动作序列
+        ///
+        /// 只由无状态响应函数处理的动作被分片到线程池中并发执行,
+        /// 其余动作(包括未提供负载、会由全部响应函数执行的动作)在调用线程上按原始顺序执行;回放期间不记录动作
+        class ReplayVerifier final
+        {
+        public:
+            explicit ReplayVerifier(Broker& broker, std::size_t threads = std::thread::hardware_concurrency())
+                :m_broker(broker), m_threads(std::max<std::size_t>(threads, 1)) {};
+
+            /// @brief 设置线程池分片大小
+            /// @param v 每次领取的动作数
+            void setChunkSize(std::size_t v) noexcept {
+                m_chunk = std::max<std::size_t>(v, 1);
+            }
+
+            template<typename Actions>
+            ReplayReport verify(Actions const& actions) {
+                ReplayReport report;
+                report.total = actions.size();
+
+                std::vector<std::size_t> stateless;
+                std::vector<std::size_t> sequence;
+                for (std::size_t i = 0; i < actions.size(); i++) {
+                    auto payload = actions[i]->payload();
+                    if (payload.arg != nullptr && m_broker.isStateless(payload.code)) {
+                        stateless.emplace_back(i);
+                    }
+                    else {
+                        sequence.emplace_back(i);
+                    }
+                }
+                report.concurrent = stateless.size();
+
+                auto writer = m_broker.writer();
+                m_broker.setWriter(nullptr);
+
+                std::atomic<std::size_t> next{ 0 };
+                std::atomic<std::size_t> failed{ 0 };
+                std::atomic<std::size_t> first{ ReplayReport::npos };
+                auto check = [&](std::size_t i) {
+                    auto& action = *actions[i];
+                    m_broker.replay(action);
+                    if (action.verify())
+                        return;
+                    failed++;
+                    auto v = first.load();
+                    while (i < v && !first.compare_exchange_weak(v, i)) {}
+                };
+                auto work = [&]() {
+                    while (true) {
+                        auto b = next.fetch_add(m_chunk);
+                        if (b >= stateless.size())
+                            break;
+                        auto e = std::min(b + m_chunk, stateless.size());
+                        for (auto i = b; i < e; i++) {
+                            check(stateless[i]);
+                        }
+                    }
+                };
+
+                auto start = std::chrono::steady_clock::now();
+                std::vector<std::thread> workers;
+                if (!stateless.empty()) {
+                    auto n = std::min(m_threads, (stateless.size() + m_chunk - 1) / m_chunk);
+                    for (std::size_t i = 1; i < n; i++) {
+                        workers.emplace_back(work);
+                    }
+                }
+                for (auto i : sequence) {
+                    check(i);
+                }
+                work();
+                for (auto& worker : workers) {
+                    worker.join();
+                }
+                auto stop = std::chrono::steady_clock::now();
+
+                m_broker.setWriter(writer);
+
+                report.failed = failed.load();
+                report.firstDiverged = first.load();
+                report.seconds = std::chrono::duration<double>(stop - start).count();
+                return report;
+            }
+        private:
+            Broker& m_broker;
+            std::size_t m_threads;
+            std::size_t m_chunk{ 256 };
+        };
+    }
+}
@@ -0,0 +1,99 @@
+﻿#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Broker.hpp"
+
+//分发性能测试:N个响应函数,每个响应N种消息中的一种
+//消息的类型标识符在运行期生成,避免为测试实例化大量类型
+
+static long long sink = 0;
+
+/// @brief 提供入口的响应函数,分发时经由索引直接执行
+class IndexedHandler final :public abc::Handler<IndexedHandler>
+{
+public:
+    explicit IndexedHandler(abc::TypeCode code) {
+        m_callbacks.emplace_back(Callback{ code,
+            [](IndexedHandler*, abc::Payload o) {
+                sink += *static_cast<const int*>(o.arg);
+            } });
+    }
+};
+
+/// @brief 不提供入口的响应函数,分发时逐个执行并比较类型标识符,作为对照
+class LinearHandler final :public abc::IHandler
+{
+    abc::TypeCode m_code;
+public:
+    explicit LinearHandler(abc::TypeCode code)
+        :m_code(code) {};
+protected:
+    void runImpl(abc::Payload payload) override {
+        if (payload.code != m_code)
+            return;
+        sink += *static_cast<const int*>(payload.arg);
+    }
+};
+
+/// @brief 携带运行期类型标识符的消息动作
+struct MessageAction final :abc::IAction {
+    abc::TypeCode code;
+    int v{ 1 };
+
+    void exec(abc::IHandler& op) override {
+        //未提供入口的响应函数,runAt会转发给runImpl
+        op.runAt(0, payload());
+    }
+    void write(abc::IWriter&, abc::IWriter::When) const override {}
+
+    abc::Payload payload() override {
+        abc::Payload result;
+        result.arg = &v;
+        result.code = code;
+        return result;
+    }
+};
+
+double Measure(std::vector<std::string> const& codes, std::size_t n, bool indexed) {
+    abc::Broker broker;
+    std::vector<MessageAction> actions(n);
+    for (std::size_t i = 0; i < n; i++) {
+        abc::TypeCode code{ codes[i].c_str(),codes[i].size() };
+        if (indexed) {
+            broker.registerHandler(IndexedHandler{ code });
+        }
+        else {
+            broker.registerHandler(LinearHandler{ code });
+        }
+        actions[i].code = code;
+    }
+
+    const std::size_t total = 1000000;
+    const std::size_t rounds = total / n;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t r = 0; r < rounds; r++) {
+        for (auto& action : actions) {
+            broker.replay(action);
+        }
+    }
+    auto stop = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration<double, std::nano>(stop - start).count();
+    return ns / static_cast<double>(rounds * n);
+}
+
+int main() {
+    std::vector<std::string> codes;
+    for (int i = 0; i < 1000; i++) {
+        codes.emplace_back("struct Message<" + std::to_string(i) + ">");
+    }
+
+    for (std::size_t n : { 10, 100, 1000 }) {
+        auto linear = Measure(codes, n, false);
+        auto indexed = Measure(codes, n, true);
+        std::cout << "handlers/types:" << n
+            << "\tlinear:" << linear << "ns"
+            << "\tindexed:" << indexed << "ns\n";
+    }
+    return sink == 0 ? 1 : 0;
+}
@@ -1,6 +1,9 @@
 ﻿#include <algorithm>
+#include <cstdio>
 #include "Broker.hpp"
 #include "JsonIO.hpp"
+#include "JournalIO.hpp"
+#include "ReplayVerifier.hpp"
 
 struct GeometryId {
     int v;
@@ -244,6 +247,18 @@ void SomeActions(Uow uow)
 }
 
 
+//未提供负载的回放动作:分发器会以exec逐个执行全部响应函数
+struct MoveLineReplayAction final :abc::IReplayAction {
+    MoveLine arg{};
+    void exec(abc::IHandler& op) override {
+        op.run(arg);
+    }
+    void write(abc::IWriter& writer, abc::IWriter::When when) const override {
+        writer.push(abc::Payload(arg), when);
+    }
+    bool verify() const override { return true; }
+};
+
 void registerWriters(JsonWriter& writer) {
     writer.registerWriter<CreateLine,GeometryId>();
     writer.registerWriter<DestoryLine>();
@@ -256,6 +271,18 @@ void registerReaders(JsonReader& reader) {
     reader.registerReader<MoveLine>();
 }
 
+void registerWriters(JournalWriter& writer) {
+    writer.registerWriter<CreateLine, GeometryId>();
+    writer.registerWriter<DestoryLine>();
+    writer.registerWriter<MoveLine>();
+}
+
+void registerReaders(JournalReader& reader) {
+    reader.registerReader<CreateLine, GeometryId>();
+    reader.registerReader<DestoryLine>();
+    reader.registerReader<MoveLine>();
+}
+
 #include <iostream>
 int main(int argc, char** argv) {
     LineRepo     repo;
@@ -293,10 +320,42 @@ int main(int argc, char** argv) {
     for (auto& action : actions) {
         broker.replay(*action);
     }
+
+    //使用二进制动作日志记录,动作完成即追加到文件,不在内存中累积
+    {
+        std::remove("actions.journal");
+        auto journal = std::make_shared<JournalWriter>();
+        registerWriters(*journal);
+        journal->open("actions.journal");
+        broker.setWriter(journal);
+
+        repo.reboot();
+        SomeActions(uow);
+        journal->close();
+        broker.setWriter(nullptr);
+
+        //从映射的日志文件中逐条读取并回放
+        JournalReader reader;
+        registerReaders(reader);
+        reader.open("actions.journal");
+
+        repo.reboot();
+        std::size_t count = 0;
+        std::size_t failed = 0;
+        while (auto action = reader.next()) {
+            broker.replay(*action);
+            count++;
+            if (!action->verify()) {
+                failed++;
+            }
+        }
+        std::cout << "journal replay:" << count << " actions," << failed << " failed\n";
+    }
 #if 1
     broker.registerHandler(
         abc::MakeCallableHandler([](std::string const& arg, std::size_t& result) { result = arg.size(); })
         .inject<std::string, std::size_t>()
+        .markStateless()
     );
 
     std::string str1 = "liff.engineer@gmail.com";
@@ -304,6 +363,45 @@ int main(int argc, char** argv) {
 
     std::string str2 = "dispatcher";
     std::cout << "str2(" << str2 << ") length:" << broker.dispatch<std::size_t>(str2) << "\n";
+
+    //无状态的动作可以并发回放校验,有状态的动作按原始顺序回放
+    {
+        auto recorder = std::make_shared<JsonWriter>();
+        registerWriters(*recorder);
+        recorder->registerWriter<std::string, std::size_t>();
+        broker.setWriter(recorder);
+
+        repo.reboot();
+        for (int i = 0; i < 10000; i++) {
+            broker.dispatch<std::size_t>(std::to_string(i));
+            if (i % 100 == 0) {
+                SomeActions(uow);
+            }
+        }
+        broker.setWriter(nullptr);
+
+        JsonReader reader;
+        registerReaders(reader);
+        reader.registerReader<std::string, std::size_t>();
+        auto actions = reader.read(recorder->result());
+        //未提供负载的动作同样会由有状态的响应函数执行,只能按原始顺序回放
+        for (int i = 0; i < 100; i++) {
+            auto action = std::make_unique<MoveLineReplayAction>();
+            action->arg = MoveLine{ GeometryId{ i },Point{ 1,1 } };
+            actions.emplace_back(std::move(action));
+        }
+
+        repo.reboot();
+        auto report = abc::ReplayVerifier(broker).verify(actions);
+        std::cout << "replay verify:" << report.total << " actions(" << report.concurrent << " concurrent),"
+            << report.failed << " failed," << report.throughput() << " actions/s\n";
+        if (report.concurrent != 10000) {
+            std::cout << "payload-less actions replayed concurrently\n";
+        }
+        if (!report.succeed()) {
+            std::cout << "first diverged action:" << report.firstDiverged << "\n";
+        }
+    }
 #endif
     return 0;
 }
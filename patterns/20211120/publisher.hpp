@@ -5,6 +5,13 @@
 #include <memory>
 #include <vector>
 #include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <algorithm>
+#include <utility>
+#include "handler_pool.hpp"
 
 //编译期类型ID机制可参考 https://stackoverflow.com/a/56600402
 //这里只是演示
@@ -31,6 +38,8 @@ class publisher {
 
     /// @brief 使用NVI的消息处理基类
     struct message_handler_base {
+        virtual ~message_handler_base() = default;
+
         /// @brief 类型到void*的安全转换
         /// @tparam T 类型
         /// @param obj 对象
@@ -68,27 +77,80 @@ class publisher {
         }
     };
 
+    using handler_pool_t = handler_pool<message_handler_base>;
+
     /// @brief 订阅存根
     struct stub {
         type_code code;
-        std::weak_ptr<message_handler_base> handler;
+        handler_pool_t::handle handler;
     };
     std::vector<stub> m_stubs;
+    handler_pool_t* m_pool{ new handler_pool_t{} };
+    unsigned m_publishing{};
+
+    /// @brief 移除已取消订阅的存根,发布过程中不处理
+    void tidy() {
+        if (m_publishing != 0) return;
+        m_stubs.erase(std::remove_if(m_stubs.begin(), m_stubs.end(),
+            [&](auto& o) { return m_pool->get(o.handler) == nullptr; }), m_stubs.end());
+    }
 public:
     publisher() = default;
 
+    publisher(publisher const&) = delete;
+    publisher& operator=(publisher const&) = delete;
+
+    /// @brief 移动时转移订阅列表与消息处理对象池,已有的订阅存根依然有效;不能在发布过程中移动
+    publisher(publisher&& other) noexcept
+        :m_stubs(std::move(other.m_stubs)),
+        m_pool(std::exchange(other.m_pool, nullptr)) {
+        assert(other.m_publishing == 0);
+    }
+
+    publisher& operator=(publisher&& other) noexcept {
+        if (std::addressof(other) != this) {
+            assert(m_publishing == 0 && other.m_publishing == 0);
+            if (m_pool) {
+                m_pool->close();
+            }
+            m_stubs = std::move(other.m_stubs);
+            m_pool = std::exchange(other.m_pool, nullptr);
+        }
+        return *this;
+    }
+
+    ~publisher() {
+        if (m_pool) {
+            m_pool->close();
+        }
+    }
+
     /// @brief 发布消息
     /// @tparam T 消息类型
     /// @param msg 消息体
     template<typename T>
     void publish(T const& msg) {
         constexpr auto code = type_code_of<T>();
-        for (auto& o : m_stubs) {
-            if (o.code != code) continue;
-            if (auto h = o.handler.lock(); h) {
-                h->handle(msg);
+        m_publishing++;
+        m_pool->enter();
+        try {
+            //处理过程中可能有新的订阅,因而以索引访问
+            std::size_t i = 0;
+            while (i < m_stubs.size()) {
+                auto& o = m_stubs[i++];
+                if (o.code != code) continue;
+                if (auto h = m_pool->get(o.handler)) {
+                    h->handle(msg);
+                }
             }
         }
+        catch (...) {
+            m_pool->leave();
+            m_publishing--;
+            throw;
+        }
+        m_pool->leave();
+        m_publishing--;
     }
 
     /// @brief 信道存根
@@ -104,9 +166,12 @@ public:
         template<typename Fn>
         subscribe_stub_unit subsrcibe(Fn&& fn) {
             assert(owner != nullptr);
-            auto handler = std::make_shared<message_handler<Fn, T>>(std::move(fn));
+            owner->tidy();
+            auto pool = owner->m_pool;
+            auto handler = pool->template emplace<message_handler<Fn, T>>(std::move(fn));
             owner->m_stubs.emplace_back(stub{ type_code_of<T>(),handler });
-            return[h = std::move(handler)](){};
+            //存根执行或销毁时释放消息处理对象
+            return[token = handler_pool_t::token{ pool, handler }]() { token.release(); };
         }
     };
 
@@ -201,7 +266,7 @@ public:
     explicit subscriber(T& obj) :m_obj(std::addressof(obj)) {};
 
     template<typename U, typename Fn>
-    subscriber& subscribe(U& source, Fn&& fn) {
+    subscriber& subscribe(U&& source, Fn&& fn) {
         m_stub += subscribe_helper<std::decay_t<U>>::subscribe(source,
             [obj = m_obj, h = std::move(fn)](auto arg){ std::invoke(h, obj, arg); }
         );
@@ -209,7 +274,7 @@ public:
     }
 
     template<typename U>
-    subscriber& subscribe(U& source) {
+    subscriber& subscribe(U&& source) {
         m_stub += subscribe_helper<std::decay_t<U>>::subscribe(source,
             [obj = m_obj](auto& arg) { obj->on(arg); }
         );
@@ -242,6 +307,6 @@ subscriber(T& obj)->subscriber<T>;
 /// @param fn 消息处理函数
 /// @return 订阅存根
 template<typename T, typename Fn>
-subscribe_stub subscribe(T& source, Fn&& fn) {
+subscribe_stub subscribe(T&& source, Fn&& fn) {
     return subscribe_helper<std::decay_t<T>>::subscribe(source, std::move(fn));
 }
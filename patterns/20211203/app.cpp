@@ -1,5 +1,6 @@
 ﻿#include "broker.hpp"
 #include <iostream>
+#include <string>
 
 struct Actor
 {
@@ -50,8 +51,26 @@ void example() {
     auto v2 = client.request(10, response<double>{});
 }
 
+void async_example() {
+    broker publisher{};
+    publisher.enable_async(16);
+
+    auto stub = subscribe(publisher.channel<int>(),
+        [](auto&& msg) { std::cout << "message:" << msg << "\n"; });
+    stub += subscribe(publisher.channel<broker::batch<int>>(),
+        [](auto&& msgs) { std::cout << "batch size:" << msgs.size << "\n"; });
+
+    for (int i = 0; i < 3; i++) {
+        publisher.async_publish(i);
+    }
+    publisher.async_publish(std::string{ "flush" });
+    publisher.async_publish(3);
+    publisher.pump();
+}
+
 int main(int argc, char** argv) {
     example();
+    async_example();
 
     return 0;
 }
@@ -0,0 +1,231 @@
+﻿#include "broker.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+//发布性能对比:1000个订阅者分布在100种消息类型上
+//legacy_broker复现了按顺序遍历全部订阅者、比较类型ID字符串的旧实现
+//并发模式下多个线程同时发布,同时另有线程不断订阅/取消订阅以验证快照回收
+//异步发布对比存在慢订阅者时生产者的耗时
+
+template<std::size_t I>
+struct Message {
+    int v;
+};
+
+static thread_local long long sink = 0;
+
+class legacy_broker {
+    struct handler_stub {
+        type_code code;
+        std::weak_ptr<std::function<void(const void*)>> handler;
+    };
+    std::vector<handler_stub> m_stubs;
+public:
+    template<typename T>
+    std::shared_ptr<void> subscribe(std::function<void(T const&)> fn) {
+        auto handler = std::make_shared<std::function<void(const void*)>>(
+            [fn = std::move(fn)](const void* msg) { fn(*static_cast<const T*>(msg)); });
+        m_stubs.emplace_back(handler_stub{ type_code_of<T, void>(),handler });
+        return handler;
+    }
+
+    template<typename T>
+    void publish(T const& msg) {
+        constexpr auto code = type_code_of<T, void>();
+        std::size_t i = 0;
+        while (i < m_stubs.size()) {
+            auto&& o = m_stubs[i++];
+            if (o.code != code) continue;
+            if (auto&& h = o.handler.lock()) {
+                (*h)(&msg);
+            }
+        }
+    }
+};
+
+constexpr std::size_t types = 100;
+constexpr std::size_t subscribers = 1000;
+constexpr std::size_t rounds = 10000;
+
+template<typename Broker, typename Stubs, std::size_t... Is>
+void subscribe_all(Broker& o, Stubs& stubs, std::index_sequence<Is...>) {
+    auto one = [&](auto i) {
+        using T = Message<decltype(i)::value>;
+        if constexpr (std::is_same_v<Broker, broker>) {
+            stubs.emplace_back(subscribe(o.template channel<T>(), [](T const& msg) { sink += msg.v; }));
+        }
+        else {
+            stubs.emplace_back(o.template subscribe<T>([](T const& msg) { sink += msg.v; }));
+        }
+    };
+    for (std::size_t n = 0; n < subscribers / types; n++) {
+        (one(std::integral_constant<std::size_t, Is>{}), ...);
+    }
+}
+
+template<typename Broker, std::size_t... Is>
+void publish_all(Broker& o, std::index_sequence<Is...>) {
+    (o.publish(Message<Is>{ 1 }), ...);
+}
+
+template<typename Broker, typename Stub>
+double measure() {
+    Broker o{};
+    std::vector<Stub> stubs;
+    subscribe_all(o, stubs, std::make_index_sequence<types>{});
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t r = 0; r < rounds; r++) {
+        publish_all(o, std::make_index_sequence<types>{});
+    }
+    auto stop = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration<double, std::nano>(stop - start).count();
+    return ns / static_cast<double>(rounds * types);
+}
+
+struct concurrent_result {
+    double throughput{};        //每秒发布的消息数
+    long long delivered{};      //常驻订阅者收到的消息数
+    long long expected{};
+    long long churns{};         //订阅/取消订阅次数
+    long long violations{};     //取消订阅后仍收到消息的次数
+};
+
+concurrent_result measure_concurrent(std::size_t threads, std::size_t rounds) {
+    broker o{ broker::concurrent };
+    std::vector<broker::action_stub> stubs;
+    subscribe_all(o, stubs, std::make_index_sequence<types>{});
+
+    concurrent_result result{};
+    std::atomic<bool> start{ false };
+    std::atomic<bool> stop{ false };
+    std::atomic<long long> delivered{ 0 };
+    std::atomic<long long> violations{ 0 };
+
+    std::vector<std::thread> publishers;
+    for (std::size_t t = 0; t < threads; t++) {
+        publishers.emplace_back([&]() {
+            while (!start.load()) std::this_thread::yield();
+            for (std::size_t r = 0; r < rounds; r++) {
+                publish_all(o, std::make_index_sequence<types>{});
+            }
+            delivered += sink;
+            });
+    }
+    std::thread churn([&]() {
+        while (!start.load()) std::this_thread::yield();
+        while (!stop.load()) {
+            auto alive = std::make_shared<std::atomic<bool>>(true);
+            broker::action_stub stub = subscribe(o.channel<Message<0>>(),
+                [alive, &violations](Message<0> const&) {
+                    if (!alive->load()) violations++;
+                });
+            std::this_thread::yield();
+            stub.release();
+            alive->store(false);
+            result.churns++;
+        }
+        });
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true);
+    for (auto& publisher : publishers) {
+        publisher.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    stop.store(true);
+    churn.join();
+
+    auto seconds = std::chrono::duration<double>(end - begin).count();
+    result.throughput = static_cast<double>(threads * rounds * types) / seconds;
+    result.delivered = delivered.load();
+    result.expected = static_cast<long long>(threads * rounds * subscribers);
+    result.violations = violations.load();
+    return result;
+}
+
+struct async_result {
+    double sync_ns{};       //同步发布时生产者每条消息耗时
+    double async_ns{};      //异步发布时生产者每条消息耗时
+    long long delivered{};
+    long long batches{};
+};
+
+async_result measure_async(std::size_t count) {
+    //慢订阅者
+    auto slow = [](Message<0> const& msg) {
+        auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(200);
+        while (std::chrono::steady_clock::now() < until) {}
+        sink += msg.v;
+    };
+    async_result result{};
+    {
+        broker o{};
+        broker::action_stub stub = subscribe(o.channel<Message<0>>(), slow);
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < count; i++) {
+            o.publish(Message<0>{ 1 });
+        }
+        auto stop = std::chrono::steady_clock::now();
+        result.sync_ns = std::chrono::duration<double, std::nano>(stop - start).count() / count;
+    }
+    {
+        std::atomic<long long> delivered{ 0 };
+        std::atomic<long long> batches{ 0 };
+        broker o{ broker::concurrent };
+        o.enable_async(count);
+        broker::action_stub stub = subscribe(o.channel<Message<0>>(), slow);
+        stub += subscribe(o.channel<broker::batch<Message<0>>>(), [&](broker::batch<Message<0>> const& msgs) {
+            batches++;
+            delivered += static_cast<long long>(msgs.size);
+            });
+        o.start_async();
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < count; i++) {
+            while (!o.async_publish(Message<0>{ 1 })) {
+                std::this_thread::yield();
+            }
+        }
+        auto stop = std::chrono::steady_clock::now();
+        o.stop_async();
+        result.async_ns = std::chrono::duration<double, std::nano>(stop - start).count() / count;
+        result.delivered = delivered.load();
+        result.batches = batches.load();
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    auto legacy = measure<legacy_broker, std::shared_ptr<void>>();
+    auto hashed = measure<broker, broker::action_stub>();
+    std::cout << "subscribers:" << subscribers << " types:" << types << "\n";
+    std::cout << "legacy publish:" << legacy << "ns\n";
+    std::cout << "hashed publish:" << hashed << "ns\n";
+
+    bool succeed = sink != 0;
+    std::vector<std::size_t> counts{ 1, 2, 4 };
+    if (std::thread::hardware_concurrency() > 4) {
+        counts.emplace_back(std::thread::hardware_concurrency());
+    }
+    for (auto threads : counts) {
+        auto r = measure_concurrent(threads, 1000);
+        std::cout << "concurrent publish threads:" << threads
+            << " throughput:" << r.throughput << "/s"
+            << " churns:" << r.churns
+            << " delivered:" << r.delivered << "/" << r.expected
+            << " violations:" << r.violations << "\n";
+        succeed = succeed && r.delivered == r.expected && r.violations == 0;
+    }
+
+    const std::size_t count = 100000;
+    auto r = measure_async(count);
+    std::cout << "slow subscriber sync publish:" << r.sync_ns << "ns"
+        << " async publish:" << r.async_ns << "ns"
+        << " delivered:" << r.delivered << "/" << count
+        << " batches:" << r.batches << "\n";
+    succeed = succeed && r.delivered == static_cast<long long>(count);
+    return succeed ? 0 : 1;
+}
@@ -28,8 +28,21 @@
 // 一旦与broker建立关联,就会提供broker::action_stub给对方作为存根,务必正确处理存根
 // 存根具有release接口用来释放关联,析构时也会自动调用
 // 当使用YourClass和broker关联时,存根建议作为类成员变量处理,以保证和YourClass生命周期一致
+//
+//并发模式:使用broker{broker::concurrent}构造
+//  1. publish/request可以在多个线程上同时调用,读取订阅者列表快照,无锁且不修改引用计数
+//  2. bind/release在互斥锁保护下生成新的快照,旧快照在没有读取者后由epoch_domain回收
+//     release会等待其它线程上正在进行的发布结束,返回后响应函数不会再被调用(在响应函数中release时不等待)
+//  3. 响应函数可能在多个线程上同时执行,需要自行保证线程安全
+//  4. 发布过程中新加入的订阅者不会收到本次消息
+//
+//异步发布:先调用enable_async(capacity)创建消息队列
+//  1. async_publish(msg)将消息放入多生产者单消费者环形队列,队列已满时返回false
+//  2. 调用pump()在当前线程投递队列中的消息,或者使用start_async()/stop_async()在专用线程上投递(要求并发模式)
+//  3. 连续的同类型消息作为一批投递:先发布broker::batch<T>给批量订阅者,再逐条发布给订阅者
 
 #pragma once
+#include <cstdint>
 #include <type_traits>
 #include <string_view>
 #include <functional>
@@ -37,6 +50,17 @@
 #include <vector>
 #include <cassert>
 #include <algorithm>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstring>
+#include <cstddef>
+#include <new>
+#include <limits>
+#include <utility>
+#include "handler_pool.hpp"
 
 //编译期类型ID机制可参考 https://stackoverflow.com/a/56600402
 using type_code = std::string_view;
@@ -54,9 +78,156 @@ constexpr type_code type_code_of() noexcept {
 #endif
 }
 
+//类型ID的FNV-1a哈希值,用来索引订阅者
+constexpr std::size_t type_hash(type_code code) noexcept {
+	std::uint64_t result = 14695981039346656037ull;
+	for (auto ch : code) {
+		result = (result ^ static_cast<unsigned char>(ch)) * 1099511628211ull;
+	}
+	return static_cast<std::size_t>(result);
+}
+
+template<typename... Ts>
+constexpr std::size_t type_hash_of() noexcept {
+	constexpr auto result = type_hash(type_code_of<Ts...>());
+	return result;
+}
+
+//基于epoch的延迟回收,参考 https://www.cl.cam.ac.uk/techreports/UCAM-CL-TR-579.pdf
+//读取者进入时记录当前epoch,退出时清除;对象退役时标记当时的epoch并推进epoch,
+//当所有活跃读取者记录的epoch均大于该标记时,读取者不可能再持有该对象,可以回收
+class epoch_domain {
+	struct record {
+		std::atomic<std::uint64_t> epoch{ 0 };//0表示不在读取过程中
+		std::atomic<bool> used{ true };
+		record* next{};
+		unsigned depth{};//仅由所属线程访问,支持嵌套读取
+	};
+
+	struct record_holder {
+		record* rec{};
+		~record_holder() {
+			if (rec) rec->used.store(false);
+		}
+	};
+
+	std::atomic<std::uint64_t> m_epoch{ 1 };
+	std::atomic<record*> m_records{};
+	std::mutex m_mutex;
+	std::vector<std::pair<std::uint64_t, std::shared_ptr<const void>>> m_retired;
+
+	record* acquire() {
+		for (auto rec = m_records.load(); rec; rec = rec->next) {
+			bool expected = false;
+			if (rec->used.compare_exchange_strong(expected, true))
+				return rec;
+		}
+		auto rec = new record{};
+		rec->next = m_records.load();
+		while (!m_records.compare_exchange_weak(rec->next, rec)) {}
+		return rec;
+	}
+
+	//线程记录为全局唯一,因而回收域只能通过instance()获取
+	record* local() {
+		static thread_local record_holder holder;
+		if (!holder.rec) {
+			holder.rec = acquire();
+		}
+		return holder.rec;
+	}
+
+	std::uint64_t min_active() const noexcept {
+		auto result = std::numeric_limits<std::uint64_t>::max();
+		for (auto rec = m_records.load(); rec; rec = rec->next) {
+			auto v = rec->epoch.load();
+			if (v != 0 && v < result) result = v;
+		}
+		return result;
+	}
+	epoch_domain() = default;
+public:
+	epoch_domain(epoch_domain const&) = delete;
+	epoch_domain& operator=(epoch_domain const&) = delete;
+
+	~epoch_domain() {
+		auto rec = m_records.load();
+		while (rec) {
+			auto next = rec->next;
+			delete rec;
+			rec = next;
+		}
+	}
+
+	static epoch_domain& instance() {
+		static epoch_domain domain;
+		return domain;
+	}
+
+	//读取者作用域:在其生命周期内读取到的对象不会被回收
+	class guard {
+		record* m_rec;
+	public:
+		guard() :m_rec(instance().local()) {
+			if (m_rec->depth++ == 0) {
+				m_rec->epoch.store(instance().m_epoch.load());
+			}
+		}
+		~guard() {
+			if (--m_rec->depth == 0) {
+				m_rec->epoch.store(0);
+			}
+		}
+		guard(guard const&) = delete;
+		guard& operator=(guard const&) = delete;
+	};
+
+	//退役对象:调用前必须已经使读取者无法再获取到该对象,返回退役时的epoch
+	std::uint64_t retire(std::shared_ptr<const void> obj) {
+		std::uint64_t result{};
+		std::vector<std::shared_ptr<const void>> garbage;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			result = m_epoch.fetch_add(1);
+			m_retired.emplace_back(result, std::move(obj));
+			auto bound = min_active();
+			auto it = std::partition(m_retired.begin(), m_retired.end(), [&](auto&& o) { return o.first >= bound; });
+			for (auto i = it; i != m_retired.end(); ++i) {
+				garbage.emplace_back(std::move(i->second));
+			}
+			m_retired.erase(it, m_retired.end());
+		}
+		//在锁外析构,避免析构过程中再次退役对象导致死锁
+		return result;
+	}
+
+	//等待其它线程上在指定epoch及之前开始的读取结束
+	//当前线程正在读取时直接返回,否则两个读取中的线程互相等待会死锁
+	void synchronize(std::uint64_t epoch) {
+		auto self = local();
+		if (self->depth != 0) return;
+		for (auto rec = m_records.load(); rec; rec = rec->next) {
+			if (rec == self) continue;
+			while (true) {
+				auto v = rec->epoch.load();
+				if (v == 0 || v > epoch) break;
+				std::this_thread::yield();
+			}
+		}
+	}
+};
+
+template<std::size_t I>
+struct priority_tag :priority_tag<I - 1> {};
+
+template<>
+struct priority_tag<0> {};
+
 class broker {
 
 	struct message_handler_base {
+		virtual ~message_handler_base() = default;
+
 		template<typename T>
 		const void* address_of(const T& obj) {
 			if constexpr (!std::is_polymorphic_v<T> || std::is_final_v<T>) {
@@ -105,86 +276,484 @@ class broker {
 		}
 	};
 
-	struct handler_stub {
+	using handler_pool_t = handler_pool<message_handler_base>;
+
+	//同一类型ID的订阅者列表
+	struct handler_bucket {
 		type_code code;
-		std::weak_ptr<message_handler_base> handler;
+		std::vector<handler_pool_t::handle> handlers;
 	};
 
-	std::vector<handler_stub> m_stubs;
-	unsigned                  m_concurrent_count{};
+	//并发模式下的订阅者列表快照,创建后不再修改
+	struct shared_bucket {
+		type_code code;
+		std::vector<std::shared_ptr<message_handler_base>> handlers;
+	};
+
+	struct snapshot {
+		std::unordered_map<std::size_t, std::shared_ptr<const shared_bucket>> buckets;
+	};
+
+	class shared_state {
+		std::mutex m_mutex;
+		std::shared_ptr<const snapshot> m_current{ std::make_shared<snapshot>() };
+		std::atomic<const snapshot*> m_view{ m_current.get() };
+
+		template<typename Op>
+		std::uint64_t update(std::size_t hash, Op&& op) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto next = std::make_shared<snapshot>(*m_current);
+			auto it = next->buckets.find(hash);
+			auto bucket = (it != next->buckets.end()) ?
+				std::make_shared<shared_bucket>(*it->second) : std::make_shared<shared_bucket>();
+			op(*bucket);
+			if (bucket->handlers.empty()) {
+				next->buckets.erase(hash);
+			}
+			else {
+				next->buckets[hash] = std::move(bucket);
+			}
+			std::shared_ptr<const snapshot> old = std::move(m_current);
+			m_current = std::move(next);
+			m_view.store(m_current.get());
+			return epoch_domain::instance().retire(std::move(old));
+		}
+	public:
+		shared_state() {
+			//保证回收域先于并发模式的broker构造,从而在其之后析构
+			epoch_domain::instance();
+		}
+
+		~shared_state() {
+			epoch_domain::instance().retire(std::move(m_current));
+		}
+
+		template<typename Fn>
+		void loop([[maybe_unused]] type_code code, std::size_t hash, Fn&& fn) {
+			epoch_domain::guard guard{};
+			auto&& buckets = m_view.load()->buckets;
+			auto it = buckets.find(hash);
+			if (it == buckets.end()) return;
+			assert(it->second->code == code);
+			for (auto&& h : it->second->handlers) {
+				fn(*h.get());
+			}
+		}
+
+		void insert(type_code code, std::size_t hash, std::shared_ptr<message_handler_base> handler) {
+			update(hash, [&](shared_bucket& bucket) {
+				bucket.code = code;
+				bucket.handlers.emplace_back(std::move(handler));
+				});
+		}
+
+		//返回后其它线程不会再调用该响应函数
+		void remove(std::size_t hash, const message_handler_base* handler) {
+			auto epoch = update(hash, [&](shared_bucket& bucket) {
+				auto&& handlers = bucket.handlers;
+				handlers.erase(std::remove_if(handlers.begin(), handlers.end(),
+					[&](auto&& o) { return o.get() == handler; }), handlers.end());
+				});
+			epoch_domain::instance().synchronize(epoch);
+		}
+	};
+
+	//异步消息:可平凡复制的小消息直接存储在消息内,其它消息在堆上分配
+	struct async_message {
+		static constexpr std::size_t capacity = 48;
+
+		void(*deliver)(broker*, async_message*, std::size_t) {};
+		void* ptr{};
+		alignas(std::max_align_t) unsigned char storage[capacity];
+
+		async_message() = default;
+		async_message(async_message const& other) noexcept { *this = other; }
+		async_message& operator=(async_message const& other) noexcept {
+			deliver = other.deliver;
+			if (other.ptr == other.storage) {
+				std::memcpy(storage, other.storage, capacity);
+				ptr = storage;
+			}
+			else {
+				ptr = other.ptr;
+			}
+			return *this;
+		}
+
+		template<typename T>
+		static constexpr bool is_inline() noexcept {
+			return std::is_trivially_copyable_v<T> && sizeof(T) <= capacity && alignof(T) <= alignof(std::max_align_t);
+		}
+
+		template<typename T>
+		T* get() noexcept {
+			return static_cast<T*>(ptr);
+		}
+
+		template<typename T>
+		void destroy() noexcept {
+			if constexpr (!is_inline<T>()) {
+				delete get<T>();
+			}
+			ptr = nullptr;
+		}
+	};
+
+	//有界多生产者单消费者环形队列,参考 https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+	class async_queue {
+		struct cell {
+			std::atomic<std::size_t> sequence;
+			async_message message;
+		};
+
+		std::unique_ptr<cell[]> m_cells;
+		std::size_t m_mask;
+		alignas(64) std::atomic<std::size_t> m_enqueue{ 0 };
+		alignas(64) std::atomic<std::size_t> m_dequeue{ 0 };
+
+		std::atomic<bool> m_waiting{ false };
+		std::atomic<bool> m_stop{ false };
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		std::thread m_thread;
+	public:
+		std::vector<async_message> drain;//仅由消费者使用
+		std::atomic<bool> pumping{ false };
+
+		explicit async_queue(std::size_t capacity) {
+			std::size_t n = 2;
+			while (n < capacity) n <<= 1;
+			m_cells.reset(new cell[n]);
+			m_mask = n - 1;
+			for (std::size_t i = 0; i < n; i++) {
+				m_cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		~async_queue() {
+			stop();
+			async_message message;
+			while (pop(message)) {
+				message.deliver(nullptr, &message, 0);
+			}
+		}
 
-	template<std::size_t I>
-	struct priority_tag :priority_tag<I - 1> {};
+		bool push(async_message const& message) {
+			cell* c{};
+			auto pos = m_enqueue.load(std::memory_order_relaxed);
+			while (true) {
+				c = &m_cells[pos & m_mask];
+				auto seq = c->sequence.load(std::memory_order_acquire);
+				auto dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+				if (dif == 0) {
+					if (m_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (dif < 0) {
+					return false;
+				}
+				else {
+					pos = m_enqueue.load(std::memory_order_relaxed);
+				}
+			}
+			c->message = message;
+			c->sequence.store(pos + 1, std::memory_order_release);
+			if (m_waiting.load()) {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_cv.notify_one();
+			}
+			return true;
+		}
 
-	template<>
-	struct priority_tag<0> {};
+		bool pop(async_message& message) {
+			auto pos = m_dequeue.load(std::memory_order_relaxed);
+			auto&& c = m_cells[pos & m_mask];
+			if (c.sequence.load(std::memory_order_acquire) != pos + 1)
+				return false;
+			message = c.message;
+			c.sequence.store(pos + m_mask + 1, std::memory_order_release);
+			m_dequeue.store(pos + 1, std::memory_order_relaxed);
+			return true;
+		}
+
+		bool empty() const noexcept {
+			auto pos = m_dequeue.load(std::memory_order_relaxed);
+			return m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) != pos + 1;
+		}
+
+		template<typename Fn>
+		void start(Fn&& pump) {
+			if (m_thread.joinable()) return;
+			m_stop.store(false);
+			m_thread = std::thread([this, pump = std::move(pump)]() {
+				while (!m_stop.load()) {
+					if (pump() != 0) continue;
+					//队列为空时休眠,生产者发现有等待者时唤醒;超时保证不会遗漏唤醒
+					m_waiting.store(true);
+					if (empty()) {
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_cv.wait_for(lock, std::chrono::milliseconds(1), [&]() { return m_stop.load() || !empty(); });
+					}
+					m_waiting.store(false);
+				}
+				while (pump() != 0) {}
+				});
+		}
+
+		void stop() {
+			if (!m_thread.joinable()) return;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop.store(true);
+				m_cv.notify_one();
+			}
+			m_thread.join();
+		}
+	};
+
+	template<typename T>
+	static void deliver_async(broker* o, async_message* messages, std::size_t n) {
+		//n为0时只销毁消息,用于丢弃队列中剩余的消息
+		if (n == 0) {
+			messages->template destroy<T>();
+			return;
+		}
+		//复用线程内缓冲区;取出后再发布,响应函数在同一线程再次投递同类消息时不会覆盖正在发布的内容
+		static thread_local std::vector<T> cache;
+		std::vector<T> values;
+		values.swap(cache);
+		values.clear();
+		values.reserve(n);
+		for (std::size_t i = 0; i < n; i++) {
+			values.emplace_back(std::move(*messages[i].template get<T>()));
+			messages[i].template destroy<T>();
+		}
+		o->publish(batch<T>{ values.data(), values.size() });
+		for (auto&& msg : values) {
+			o->publish(msg);
+		}
+		if (values.capacity() > cache.capacity()) {
+			values.clear();
+			cache.swap(values);
+		}
+	}
+
+	std::unordered_map<std::size_t, handler_bucket> m_buckets;
+	unsigned                  m_concurrent_count{};
+	std::shared_ptr<shared_state> m_shared;
+	std::unique_ptr<async_queue> m_queue;
+	handler_pool_t* m_pool{};
 
 	template<typename Fn>
-	void loop(type_code code, Fn&& fn) {
+	void loop(type_code code, std::size_t hash, Fn&& fn) {
+		if (m_shared) {
+			return m_shared->loop(code, hash, fn);
+		}
+		auto it = m_buckets.find(hash);
+		if (it == m_buckets.end()) return;
+		assert(it->second.code == code);
+		//响应过程中可能有新的订阅者加入,列表会扩容,因而以索引访问
+		auto&& handlers = it->second.handlers;
 		m_concurrent_count++;
+		m_pool->enter();
 		try {
 			std::size_t i = 0;
-			while (i < m_stubs.size()) {
-				auto&& o = m_stubs[i++];
-				if (o.code != code) continue;
-				if (auto&& h = o.handler.lock()) {
-					fn(*h.get());
+			while (i < handlers.size()) {
+				if (auto h = m_pool->get(handlers[i++])) {
+					fn(*h);
 				}
 			}
+			m_pool->leave();
 			m_concurrent_count--;
 		}
 		catch (...) {
+			m_pool->leave();
 			m_concurrent_count--;
 			throw;
 		}
 	}
 
-	void tidy() {
+	handler_bucket& bucket(type_code code, std::size_t hash) {
+		auto&& result = m_buckets[hash];
+		if (result.handlers.empty()) {
+			result.code = code;
+		}
+		assert(result.code == code);
+		return result;
+	}
+
+	void tidy(handler_bucket& bucket) {
 		if (0 != m_concurrent_count)
 			return;
-		m_stubs.erase(std::remove_if(m_stubs.begin(), m_stubs.end(), [](auto&& o) { return o.handler.expired(); }), m_stubs.end());
+		auto&& handlers = bucket.handlers;
+		handlers.erase(std::remove_if(handlers.begin(), handlers.end(), [&](auto&& o) { return m_pool->get(o) == nullptr; }), handlers.end());
 	}
 
 	template<typename T, typename Op>
 	auto request_impl(T const& msg, Op& op, priority_tag<1>) ->decltype(op.value()) {
 		using R = std::remove_reference_t<decltype(op.alloc())>;
-		loop(type_code_of<T, R>(), [&](auto&& h) { h.reply(msg, op.alloc()); });
+		loop(type_code_of<T, R>(), type_hash_of<T, R>(), [&](auto&& h) { h.reply(msg, op.alloc()); });
 		return op.value();
 	}
 
 	template<typename T, typename R>
 	auto request_impl(T const& msg, R& result, priority_tag<0>) ->decltype(void()) {
-		loop(type_code_of<T, R>(), [&](auto&& h) { h.reply(msg, result); });
+		loop(type_code_of<T, R>(), type_hash_of<T, R>(), [&](auto&& h) { h.reply(msg, result); });
 	}
 
 	template<typename Op>
 	auto request_impl(Op& op, priority_tag<1>)->decltype(op.value()) {
 		using R = std::remove_reference_t<decltype(op.alloc())>;
-		loop(type_code_of<void, R>(), [&](auto&& h) { h.reply(op.alloc()); });
+		loop(type_code_of<void, R>(), type_hash_of<void, R>(), [&](auto&& h) { h.reply(op.alloc()); });
 		return op.value();
 	}
 
 	template<typename R>
 	auto request_impl(R& result, priority_tag<0>) ->decltype(void()) {
-		loop(type_code_of<void, R>(), [&](auto&& h) { h.reply(result); });
+		loop(type_code_of<void, R>(), type_hash_of<void, R>(), [&](auto&& h) { h.reply(result); });
 	}
 public:
 	using action_stub_unit = std::function<void()>;
 
-	broker() = default;
+	struct concurrent_t {};
+	static constexpr concurrent_t concurrent{};
+
+	broker() :m_pool(new handler_pool_t{}) {};
+
+	//并发模式
+	explicit broker(concurrent_t) :m_shared(std::make_shared<shared_state>()) {};
+
+	broker(broker const&) = delete;
+	broker& operator=(broker const&) = delete;
+
+	//移动时会停止源对象的专用投递线程(线程持有源对象地址),需要时在新对象上重新start_async;
+	//已绑定的存根引用的是响应函数池与快照,移动后依然有效;不能在消息处理过程中移动,移动后的源对象只能销毁或被赋值
+	broker(broker&& other) noexcept {
+		assert(other.m_concurrent_count == 0);
+		//停止时会投递完队列中的消息,需要在移动状态之前进行
+		other.stop_async();
+		m_buckets = std::move(other.m_buckets);
+		m_shared = std::move(other.m_shared);
+		m_queue = std::move(other.m_queue);
+		m_pool = std::exchange(other.m_pool, nullptr);
+	}
+
+	broker& operator=(broker&& other) noexcept {
+		if (std::addressof(other) != this) {
+			assert(m_concurrent_count == 0 && other.m_concurrent_count == 0);
+			stop_async();
+			if (m_pool) {
+				m_pool->close();
+			}
+			other.stop_async();
+			m_buckets = std::move(other.m_buckets);
+			m_shared = std::move(other.m_shared);
+			m_queue = std::move(other.m_queue);
+			m_pool = std::exchange(other.m_pool, nullptr);
+		}
+		return *this;
+	}
+
+	~broker() {
+		stop_async();
+		if (m_pool) {
+			m_pool->close();
+		}
+	}
+
+	//批量消息:异步投递时连续的同类型消息
+	template<typename T>
+	struct batch {
+		const T* data{};
+		std::size_t size{};
+
+		const T* begin() const noexcept { return data; }
+		const T* end() const noexcept { return data + size; }
+	};
+
+	//创建异步消息队列,需要在异步发布之前调用
+	void enable_async(std::size_t capacity = 1024) {
+		assert(!m_queue);
+		m_queue = std::make_unique<async_queue>(capacity);
+	}
+
+	//异步发布消息,可以在多个线程上同时调用;队列已满时返回false
+	template<typename T>
+	bool async_publish(T&& msg) {
+		using U = std::decay_t<T>;
+		assert(m_queue != nullptr);
+		async_message message;
+		message.deliver = &broker::deliver_async<U>;
+		if constexpr (async_message::is_inline<U>()) {
+			message.ptr = new(message.storage) U(std::forward<T>(msg));
+		}
+		else {
+			message.ptr = new U(std::forward<T>(msg));
+		}
+		if (m_queue->push(message))
+			return true;
+		message.deliver(this, &message, 0);
+		return false;
+	}
+
+	//在当前线程投递队列中的消息,同一时刻只能有一个线程投递,嵌套调用时直接返回
+	//返回投递的消息数
+	std::size_t pump(std::size_t limit = std::numeric_limits<std::size_t>::max()) {
+		if (!m_queue || m_queue->pumping.exchange(true))
+			return 0;
+		auto&& drain = m_queue->drain;
+		drain.clear();
+		async_message message;
+		while (drain.size() < limit && m_queue->pop(message)) {
+			drain.emplace_back(message);
+		}
+		std::size_t i = 0;
+		try {
+			while (i < drain.size()) {
+				auto j = i + 1;
+				while (j < drain.size() && drain[j].deliver == drain[i].deliver) j++;
+				auto first = i;
+				i = j;
+				drain[first].deliver(this, drain.data() + first, j - first);
+			}
+		}
+		catch (...) {
+			//丢弃尚未投递的消息
+			for (; i < drain.size(); i++) {
+				drain[i].deliver(nullptr, &drain[i], 0);
+			}
+			m_queue->pumping.store(false);
+			throw;
+		}
+		m_queue->pumping.store(false);
+		return drain.size();
+	}
+
+	//在专用线程上投递异步消息,要求并发模式
+	void start_async() {
+		assert(m_queue != nullptr && m_shared != nullptr);
+		m_queue->start([this]() { return pump(); });
+	}
+
+	//停止专用线程,停止前会投递完队列中的消息
+	void stop_async() {
+		if (m_queue) {
+			m_queue->stop();
+		}
+	}
 
 	template<typename T>
 	void publish(T const& msg) {
-		loop(type_code_of<T, void>(), [&](auto&& h) { h.on(msg); });
+		loop(type_code_of<T, void>(), type_hash_of<T, void>(), [&](auto&& h) { h.on(msg); });
 	}
 
 	template<typename T, typename R>
-	decltype(auto) request(const T& msg, R& result) {
+	decltype(auto) request(const T& msg, R&& result) {
 		return request_impl(msg, result, priority_tag<2>{});
 	}
 
 	template<typename R>
-	decltype(auto) request(R& result) {
+	decltype(auto) request(R&& result) {
 		return request_impl(result, priority_tag<2>{});
 	}
 
@@ -195,10 +764,32 @@ public:
 		template<typename Fn>
 		action_stub_unit bind(Fn&& fn) {
 			assert(owner != nullptr);
-			owner->tidy();
+			if (owner->m_shared) {
+				return bind_shared(std::move(fn));
+			}
+			auto&& bucket = owner->bucket(type_code_of<T, R>(), type_hash_of<T, R>());
+			owner->tidy(bucket);
+			auto pool = owner->m_pool;
+			auto handle = pool->template emplace<message_handler<Fn, T, R>>(std::move(fn));
+			bucket.handlers.emplace_back(handle);
+			//存根执行或销毁时释放响应函数
+			return[token = handler_pool_t::token{ pool, handle }]() { token.release(); };
+		}
+	private:
+		//存根销毁时从快照中移除响应函数
+		template<typename Fn>
+		action_stub_unit bind_shared(Fn&& fn) {
+			constexpr auto hash = type_hash_of<T, R>();
 			auto handler = std::make_shared<message_handler<Fn, T, R>>(std::move(fn));
-			owner->m_stubs.emplace_back(handler_stub{ type_code_of<T,R>(),handler });
-			return[h = std::move(handler)](){};
+			auto address = handler.get();
+			owner->m_shared->insert(type_code_of<T, R>(), hash, std::move(handler));
+			std::shared_ptr<void> token(nullptr,
+				[state = std::weak_ptr<shared_state>(owner->m_shared), address](void*) {
+					if (auto&& o = state.lock()) {
+						o->remove(hash, address);
+					}
+				});
+			return[h = std::move(token)](){};
 		}
 	};
 
@@ -291,7 +882,7 @@ public:
 	explicit subscriber(T& obj) :m_obj(std::addressof(obj)) {};
 
 	template<typename U, typename Fn>
-	subscriber& subscribe(U& source, Fn&& fn) {
+	subscriber& subscribe(U&& source, Fn&& fn) {
 		m_stub += subscribe_helper<std::decay_t<U>>::subscribe(source,
 			[obj = m_obj, h = std::move(fn)](auto arg){ std::invoke(h, obj, arg); }
 		);
@@ -299,7 +890,7 @@ public:
 	}
 
 	template<typename U>
-	subscriber& subscribe(U& source) {
+	subscriber& subscribe(U&& source) {
 		m_stub += subscribe_helper<std::decay_t<U>>::subscribe(source,
 			[obj = m_obj](auto& arg) { obj->on(arg); }
 		);
@@ -326,7 +917,7 @@ template<typename T>
 subscriber(T& obj)->subscriber<T>;
 
 template<typename T, typename Fn>
-broker::action_stub subscribe(T& source, Fn&& fn) {
+broker::action_stub subscribe(T&& source, Fn&& fn) {
 	return subscribe_helper<std::decay_t<T>>::subscribe(source, std::move(fn));
 }
 
@@ -338,7 +929,7 @@ public:
 	explicit binder(T& obj) :m_obj(std::addressof(obj)) {};
 
 	template<typename U, typename R, typename Fn>
-	binder& bind(broker::endpoint_stub<U, R>& ep, Fn&& fn) {
+	binder& bind(broker::endpoint_stub<U, R> ep, Fn&& fn) {
 		if constexpr (std::is_same_v<U, void>) {
 			m_stub += ep.bind([obj = m_obj, h = std::move(fn)](auto&& result){ std::invoke(h, obj, result); });
 		}
@@ -350,7 +941,7 @@ public:
 	}
 
 	template<typename U, typename R>
-	binder& bind(broker::endpoint_stub<U, R>& ep) {
+	binder& bind(broker::endpoint_stub<U, R> ep) {
 		if constexpr (std::is_same_v<U, void>) {
 			m_stub += ep.bind([obj = m_obj](auto&& result) { obj->reply(result); });
 		}
@@ -380,7 +971,7 @@ template<typename T>
 binder(T& obj)->binder<T>;
 
 template<typename T, typename R, typename Fn>
-broker::action_stub bind(broker::endpoint_stub<T, R>& ep, Fn&& fn) {
+broker::action_stub bind(broker::endpoint_stub<T, R> ep, Fn&& fn) {
 	return ep.bind(std::move(fn));
 }
 
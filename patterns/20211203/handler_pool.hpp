@@ -0,0 +1,210 @@
+﻿#pragma once
+#include <type_traits>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <utility>
+
+/// @brief 消息处理对象池:按块分配存储,使用带代数的句柄引用对象
+///
+/// 避免订阅时的堆分配以及发布时weak_ptr::lock的引用计数操作
+///  - 句柄的代数与槽位不一致时表示对象已释放,槽位可以被复用
+///  - 在enter/leave之间释放的对象延迟到最外层leave时销毁,以支持在处理函数中取消订阅
+///  - 池由所有者及存根令牌共同引用,所有者close后仍可安全释放令牌
+///  - 存根令牌可复制,最后一个副本销毁时释放对象,丢弃存根即取消订阅
+///  - 池及其令牌只能在所有者所在线程使用
+/// @tparam Base 对象基类,需要有虚析构函数
+template<typename Base>
+class handler_pool {
+public:
+	/// @brief 对象句柄
+	struct handle {
+		std::uint32_t index{};
+		std::uint32_t generation{};
+	};
+private:
+	static constexpr std::size_t inline_size = 64;
+	static constexpr std::size_t block_size = 64;
+	static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+	struct slot {
+		alignas(std::max_align_t) unsigned char storage[inline_size];
+		Base* object{};
+		std::uint32_t generation{ 1 };
+		std::uint32_t next{ npos };
+		std::uint32_t tokens{};
+	};
+
+	std::vector<std::unique_ptr<slot[]>> m_blocks;
+	std::vector<std::uint32_t> m_pending;
+	std::uint32_t m_free{ npos };
+	std::uint32_t m_size{};
+	std::size_t m_refs{ 1 };
+	unsigned m_depth{};
+	bool m_closed{};
+
+	slot& at(std::uint32_t index) noexcept {
+		return m_blocks[index / block_size][index % block_size];
+	}
+
+	void destroy(slot& s) noexcept {
+		if (!s.object) return;
+		if (static_cast<void*>(s.object) == static_cast<void*>(s.storage)) {
+			s.object->~Base();
+		}
+		else {
+			delete s.object;
+		}
+		s.object = nullptr;
+	}
+
+	void recycle(std::uint32_t index) noexcept {
+		auto&& s = at(index);
+		destroy(s);
+		s.next = m_free;
+		m_free = index;
+	}
+
+	void unref() noexcept {
+		if (--m_refs == 0) {
+			delete this;
+		}
+	}
+
+	void retain(handle h) noexcept {
+		m_refs++;
+		auto&& s = at(h.index);
+		if (s.generation == h.generation) {
+			s.tokens++;
+		}
+	}
+
+	void drop(handle h) noexcept {
+		auto&& s = at(h.index);
+		if (s.generation == h.generation && --s.tokens == 0) {
+			release(h);
+		}
+		unref();
+	}
+
+	~handler_pool() = default;
+public:
+	/// @brief 存根令牌:持有池的引用,最后一个副本销毁时释放对象
+	class token {
+		handler_pool* m_pool{};
+		handle m_handle{};
+	public:
+		token() = default;
+		token(handler_pool* pool, handle h) noexcept
+			:m_pool(pool), m_handle(h) {
+			m_pool->retain(m_handle);
+		}
+		token(token const& other) noexcept
+			:m_pool(other.m_pool), m_handle(other.m_handle) {
+			if (m_pool) m_pool->retain(m_handle);
+		}
+		token(token&& other) noexcept
+			:m_pool(other.m_pool), m_handle(other.m_handle) {
+			other.m_pool = nullptr;
+		}
+		token& operator=(token other) noexcept {
+			std::swap(m_pool, other.m_pool);
+			std::swap(m_handle, other.m_handle);
+			return *this;
+		}
+		~token() {
+			if (m_pool) m_pool->drop(m_handle);
+		}
+
+		/// @brief 立即释放对象,其它副本随之失效
+		void release() const noexcept {
+			if (m_pool) m_pool->release(m_handle);
+		}
+	};
+
+	handler_pool() = default;
+	handler_pool(handler_pool const&) = delete;
+	handler_pool& operator=(handler_pool const&) = delete;
+
+	/// @brief 构造对象,小对象直接存储在槽位中
+	/// @tparam T 对象类型
+	/// @param ...args 构造参数
+	/// @return 对象句柄
+	template<typename T, typename... Args>
+	handle emplace(Args&&... args) {
+		static_assert(std::is_base_of_v<Base, T>, "T should be derived from Base");
+		std::uint32_t index = m_free;
+		const bool fresh = (index == npos);
+		if (fresh) {
+			if (m_blocks.size() * block_size <= m_size) {
+				m_blocks.emplace_back(new slot[block_size]);
+			}
+			index = m_size;
+		}
+		auto&& s = at(index);
+		if constexpr (sizeof(T) <= inline_size && alignof(T) <= alignof(std::max_align_t)) {
+			s.object = new(s.storage) T(std::forward<Args>(args)...);
+		}
+		else {
+			s.object = new T(std::forward<Args>(args)...);
+		}
+		if (fresh) {
+			m_size++;
+		}
+		else {
+			m_free = s.next;
+		}
+		s.tokens = 0;
+		return handle{ index,s.generation };
+	}
+
+	/// @brief 获取句柄对应的对象
+	/// @param h 句柄
+	/// @return 对象,已释放时返回空
+	Base* get(handle h) noexcept {
+		auto&& s = at(h.index);
+		return (s.generation == h.generation) ? s.object : nullptr;
+	}
+
+	void enter() noexcept {
+		m_depth++;
+	}
+
+	void leave() noexcept {
+		if (--m_depth != 0) return;
+		for (auto index : m_pending) {
+			recycle(index);
+		}
+		m_pending.clear();
+	}
+
+	/// @brief 释放句柄,同一句柄多次释放无影响
+	/// @param h 句柄
+	void release(handle h) noexcept {
+		auto&& s = at(h.index);
+		if (s.generation != h.generation) return;
+		s.generation++;
+		if (m_closed) {
+			destroy(s);
+		}
+		else if (m_depth != 0) {
+			m_pending.emplace_back(h.index);
+		}
+		else {
+			recycle(h.index);
+		}
+	}
+
+	/// @brief 所有者销毁时调用,销毁所有对象
+	void close() noexcept {
+		m_closed = true;
+		for (std::uint32_t i = 0; i < m_size; i++) {
+			destroy(at(i));
+		}
+		m_pending.clear();
+		unref();
+	}
+};
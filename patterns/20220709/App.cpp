@@ -2,6 +2,10 @@
 #include <iostream>
 #include <string>
 
+#ifndef _MSC_VER
+#define __FUNCSIG__ __PRETTY_FUNCTION__
+#endif
+
 using Event = v0::Event;
 namespace v0
 {
@@ -220,6 +224,39 @@ namespace v6
     }
 }
 
+namespace v7
+{
+    class MyObserver
+    {
+    public:
+        void update(double event)
+        {
+            std::cout << __FUNCSIG__ << ":" << event << '\n';
+        }
+        void update(const Event &event)
+        {
+            std::cout << __FUNCSIG__ << ":" << event.payload << '\n';
+        }
+    };
+
+    void test()
+    {
+        Publisher publisher{};
+        MyObserver ob{};
+
+        publisher.subscribe<double>(&ob);
+        auto id = publisher.subscribe<Event>(&ob);
+        publisher.subscribe<Event>([](const Event &e)
+                                   { std::cout << __FUNCSIG__ << ":" << e.payload << '\n'; });
+
+        publisher.notify(3.1415926);
+        publisher.notify(Event{"message coming"});
+
+        publisher.unsubscribe(id);
+        publisher.notify(Event{"only callable"});
+    }
+}
+
 int main()
 {
     v0::test();
@@ -229,5 +266,6 @@ int main()
     v4::test();
     v5::test();
     v6::test();
+    v7::test();
     return 0;
 }
@@ -2,7 +2,11 @@
 #include <vector>
 #include <algorithm>
 #include <memory>
-//#include <type_traits>
+#include <string>
+#include <typeinfo>
+#include <cstdint>
+#include <unordered_map>
+#include <type_traits>
 
 /// @brief 常规的观察者实现方式
 namespace v0
@@ -705,3 +709,196 @@ namespace v6
         std::vector<std::unique_ptr<IObserver>> m_observers;
     };
 }
+
+/// @brief 以整数类型索引划分的连续通道,避免字符串比较和dynamic_cast
+namespace v7
+{
+    class Publisher
+    {
+    public:
+        /// @brief 订阅标识:高32位为事件类型索引,低32位为通道内序号
+        using Id = std::uint64_t;
+
+        template <typename E>
+        void notify(const E &event)
+        {
+            auto index = TypeIndex<E>();
+            if (index >= m_channels.size())
+            {
+                return;
+            }
+            //观察者抛出异常时也要恢复通知计数,否则通道再也不会整理
+            NotifyScope scope{*this, index};
+            //通知过程中可能产生新的订阅,通道及观察者数组都可能扩容,因而以索引访问
+            for (std::size_t i = 0; i < m_channels[index].slots.size(); i++)
+            {
+                auto slot = m_channels[index].slots[i];
+                if (slot.thunk)
+                {
+                    slot.thunk(slot.obj, &event);
+                }
+            }
+        }
+
+        template <typename E, typename T>
+        Id subscribe(T *obj)
+        {
+            auto index = TypeIndex<E>();
+            auto &channel = acquire(index);
+            for (auto &&slot : channel.slots)
+            {
+                if (slot.thunk && slot.obj == obj)
+                {
+                    return MakeId(index, slot.serial);
+                }
+            }
+            return add(index, obj, [](void *o, const void *e)
+                       { static_cast<T *>(o)->update(*static_cast<const E *>(e)); });
+        }
+
+        template <typename E, typename Fn>
+        Id subscribe(Fn &&fn)
+        {
+            using T = std::remove_cv_t<std::remove_reference_t<Fn>>;
+            std::unique_ptr<void, void (*)(void *)> owner(new T(std::forward<Fn>(fn)), [](void *o)
+                                                          { delete static_cast<T *>(o); });
+            auto id = add(TypeIndex<E>(), owner.get(), [](void *o, const void *e)
+                          { (*static_cast<T *>(o))(*static_cast<const E *>(e)); });
+            m_callables.emplace(id, std::move(owner));
+            return id;
+        }
+
+        void unsubscribe(Id id)
+        {
+            auto index = static_cast<std::size_t>(id >> 32);
+            auto serial = static_cast<std::uint32_t>(id);
+            if (index >= m_channels.size())
+            {
+                return;
+            }
+            auto &channel = m_channels[index];
+            for (auto &&slot : channel.slots)
+            {
+                if (slot.thunk && slot.serial == serial)
+                {
+                    slot.thunk = nullptr;
+                    slot.obj = nullptr;
+                    channel.dirty = true;
+                    break;
+                }
+            }
+            //通知过程中不能销毁正在执行的可调用对象,延迟到通道整理时
+            if (channel.notifying == 0)
+            {
+                m_callables.erase(id);
+            }
+            else
+            {
+                channel.expired.emplace_back(id);
+            }
+            compact(channel);
+        }
+
+    private:
+        using Thunk = void (*)(void *, const void *);
+
+        struct Slot
+        {
+            void *obj;
+            Thunk thunk;
+            std::uint32_t serial;
+        };
+
+        struct Channel
+        {
+            std::vector<Slot> slots;
+            std::vector<Id> expired;
+            std::uint32_t serial{};
+            unsigned notifying{};
+            bool dirty{};
+        };
+
+        /// @brief 通知期间的计数守卫,离开作用域时恢复计数并整理通道
+        class NotifyScope
+        {
+        public:
+            NotifyScope(Publisher &publisher, std::size_t index) noexcept
+                : m_publisher(publisher), m_index(index)
+            {
+                m_publisher.m_channels[m_index].notifying++;
+            }
+            NotifyScope(const NotifyScope &) = delete;
+            NotifyScope &operator=(const NotifyScope &) = delete;
+            ~NotifyScope()
+            {
+                //通道数组可能已扩容,重新按索引取得通道
+                auto &channel = m_publisher.m_channels[m_index];
+                channel.notifying--;
+                m_publisher.compact(channel);
+            }
+
+        private:
+            Publisher &m_publisher;
+            std::size_t m_index;
+        };
+
+        static std::size_t NextTypeIndex() noexcept
+        {
+            static std::size_t index = 0;
+            return index++;
+        }
+
+        /// @brief 事件类型索引,首次使用时分配
+        template <typename E>
+        static std::size_t TypeIndex() noexcept
+        {
+            static const std::size_t index = NextTypeIndex();
+            return index;
+        }
+
+        static Id MakeId(std::size_t index, std::uint32_t serial) noexcept
+        {
+            return (static_cast<Id>(index) << 32) | serial;
+        }
+
+        Channel &acquire(std::size_t index)
+        {
+            if (index >= m_channels.size())
+            {
+                m_channels.resize(index + 1);
+            }
+            return m_channels[index];
+        }
+
+        Id add(std::size_t index, void *obj, Thunk thunk)
+        {
+            auto &channel = acquire(index);
+            auto serial = ++channel.serial;
+            channel.slots.emplace_back(Slot{obj, thunk, serial});
+            return MakeId(index, serial);
+        }
+
+        /// @brief 移除已取消的订阅,保持订阅顺序
+        void compact(Channel &channel)
+        {
+            if (channel.notifying != 0 || !channel.dirty)
+            {
+                return;
+            }
+            channel.slots.erase(std::remove_if(channel.slots.begin(), channel.slots.end(),
+                                               [](const Slot &slot)
+                                               { return slot.thunk == nullptr; }),
+                                channel.slots.end());
+            for (auto id : channel.expired)
+            {
+                m_callables.erase(id);
+            }
+            channel.expired.clear();
+            channel.dirty = false;
+        }
+
+    private:
+        std::vector<Channel> m_channels;
+        std::unordered_map<Id, std::unique_ptr<void, void (*)(void *)>> m_callables;
+    };
+}
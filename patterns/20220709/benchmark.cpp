@@ -0,0 +1,161 @@
+#include "Observer.hpp"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using Event = v0::Event;
+
+namespace
+{
+    constexpr std::size_t kObservers = 100;
+    constexpr std::size_t kRounds = 20000;
+
+    double g_sum = 0.0;
+    std::size_t g_count = 0;
+
+    template <typename Fn>
+    void measure(const char *name, Fn &&notify)
+    {
+        g_sum = 0.0;
+        notify(0.0);
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < kRounds; i++)
+        {
+            notify(static_cast<double>(i));
+        }
+        auto stop = std::chrono::steady_clock::now();
+        auto ns = std::chrono::duration<double, std::nano>(stop - start).count();
+        std::printf("%-4s %10.1f ns/notify %8.2f ns/observer (checksum %.0f)\n",
+                    name, ns / kRounds, ns / kRounds / kObservers, g_sum);
+    }
+
+    /// @brief 除double观察者外,每个发布者再挂同等数量的Event观察者,体现按类型过滤的开销
+    class Counter
+    {
+    public:
+        void update(double event) { g_sum += event; }
+        void update(const Event &) { g_count++; }
+    };
+
+    namespace b0
+    {
+        class Observer : public v0::IObserver
+        {
+        public:
+            void update(double event) override { g_sum += event; }
+        };
+    }
+
+    namespace b1
+    {
+        class Observer : public v1::IObserver<double>
+        {
+        public:
+            void update(const double &event) override { g_sum += event; }
+        };
+    }
+
+    namespace b2
+    {
+        class DoubleObserver : public v2::Observer<double>
+        {
+        public:
+            void update(const double &event) override { g_sum += event; }
+        };
+
+        class EventObserver : public v2::Observer<Event>
+        {
+        public:
+            void update(const Event &) override { g_count++; }
+        };
+    }
+}
+
+int main()
+{
+    std::vector<Counter> counters(kObservers);
+    {
+        std::vector<b0::Observer> observers(kObservers);
+        v0::Subject subject{};
+        for (auto &&ob : observers)
+        {
+            subject.subscribe(&ob);
+        }
+        measure("v0", [&](double e)
+                { subject.notify(e); });
+    }
+    {
+        std::vector<b1::Observer> observers(kObservers);
+        v1::Subject<double> subject{};
+        for (auto &&ob : observers)
+        {
+            subject.subscribe(&ob);
+        }
+        measure("v1", [&](double e)
+                { subject.notify(e); });
+    }
+    {
+        std::vector<b2::DoubleObserver> doubles(kObservers);
+        std::vector<b2::EventObserver> events(kObservers);
+        v2::Publisher publisher{};
+        for (std::size_t i = 0; i < kObservers; i++)
+        {
+            publisher.subscribe(&doubles[i]);
+            publisher.subscribe(&events[i]);
+        }
+        measure("v2", [&](double e)
+                { publisher.notify(e); });
+    }
+    {
+        v3::Publisher publisher{};
+        for (auto &&ob : counters)
+        {
+            publisher.subscribe<double>(&ob);
+            publisher.subscribe<Event>(&ob);
+        }
+        measure("v3", [&](double e)
+                { publisher.notify(e); });
+    }
+    {
+        v4::Publisher publisher{};
+        for (auto &&ob : counters)
+        {
+            publisher.subscribe<double>(&ob);
+            publisher.subscribe<Event>(&ob);
+        }
+        measure("v4", [&](double e)
+                { publisher.notify(e); });
+    }
+    {
+        v5::Publisher publisher{};
+        std::vector<v5::Publisher::Stub> stubs;
+        for (auto &&ob : counters)
+        {
+            stubs.emplace_back(publisher.subscribe<double>(&ob));
+            stubs.emplace_back(publisher.subscribe<Event>(&ob));
+        }
+        measure("v5", [&](double e)
+                { publisher.notify(e); });
+    }
+    {
+        v6::Publisher publisher{};
+        for (auto &&ob : counters)
+        {
+            publisher.subscribe<double>(&ob);
+            publisher.subscribe<Event>(&ob);
+        }
+        measure("v6", [&](double e)
+                { publisher.notify(e); });
+    }
+    {
+        v7::Publisher publisher{};
+        for (auto &&ob : counters)
+        {
+            publisher.subscribe<double>(&ob);
+            publisher.subscribe<Event>(&ob);
+        }
+        measure("v7", [&](double e)
+                { publisher.notify(e); });
+    }
+    return 0;
+}
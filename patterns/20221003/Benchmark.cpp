@@ -0,0 +1,87 @@
+﻿#include "Graph.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace
+{
+    template<typename Fn>
+    double measure(Fn&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(stop - start).count();
+    }
+
+    //构建n个规则/节点/连接的图文档,耗时应随n线性增长
+    void run(unsigned n) {
+        Document doc{};
+        auto rules = measure([&]() {
+            for (unsigned i = 0; i < n; i++) {
+                doc.Create<Rule>("rule" + std::to_string(i), "description",
+                    std::vector<Port>{
+                    Port{ "in","input",PortType::in },
+                        Port{ "out","output",PortType::out }
+                });
+            }
+            });
+
+        auto nodes = measure([&]() {
+            auto view = doc.View<Rule>();
+            for (unsigned i = 0; i < n; i++) {
+                doc.Create<Node>(view->find(i + 1), Point{ i * 1.0,0.0 });
+            }
+            });
+
+        auto connects = measure([&]() {
+            auto view = doc.View<Node>();
+            for (unsigned i = 1; i < n; i++) {
+                doc.Create<Connect>(view->find(i), "out", view->find(i + 1), "in");
+            }
+            });
+
+        std::mt19937 gen{ 42 };
+        std::uniform_int_distribution<unsigned> pick{ 1, n };
+        double sum = 0.0;
+        auto finds = measure([&]() {
+            auto view = doc.View<Node>();
+            for (unsigned i = 0; i < n; i++) {
+                if (auto node = view->find(pick(gen))) {
+                    sum += node->position().x;
+                }
+            }
+            });
+
+        auto traverse = measure([&]() {
+            doc.View<Node>()->visit([&](EntityRef<Node*> node) {
+                sum += node->position().x;
+                });
+            doc.View<Connect>()->visit([&](EntityRef<Connect*> connect) {
+                sum += connect->src()->position().y;
+                });
+            });
+
+        //销毁一半节点后重新创建,复用空闲槽位
+        auto recreate = measure([&]() {
+            auto view = doc.View<Node>();
+            auto rule = doc.View<Rule>()->find(1);
+            for (unsigned i = 1; i <= n; i += 2) {
+                view->destory(view->find(i));
+            }
+            for (unsigned i = 1; i <= n; i += 2) {
+                doc.Create<Node>(rule, Point{ 1.0,1.0 });
+            }
+            });
+
+        std::printf("%7u: rules %8.2f ms, nodes %8.2f ms, connects %8.2f ms, finds %8.2f ms, traverse %8.2f ms, recreate %8.2f ms (checksum %.0f)\n",
+            n, rules, nodes, connects, finds, traverse, recreate, sum);
+    }
+}
+
+int main()
+{
+    for (unsigned n : { 10000u, 100000u, 1000000u }) {
+        run(n);
+    }
+    return 0;
+}
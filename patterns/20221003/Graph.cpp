@@ -1,47 +1,127 @@
 ﻿#include "Graph.hpp"
+#include <unordered_map>
+#include <typeinfo>
+#include <new>
 
 class IDataSet {
 public:
     virtual ~IDataSet() = default;
 };
 
+//唯一键策略:特化并提供type与of,实体集合即为该类型维护唯一键索引
+template<typename T, typename E = void>
+struct UniqueKey :std::false_type {};
+
+template<>
+struct UniqueKey<Rule> :std::true_type {
+    using type = std::string;
+    static const std::string& of(const Rule& o) noexcept { return o.code(); }
+};
+
+template<typename T, bool Enable = UniqueKey<T>::value>
+struct UniqueIndex {
+    void insert(const T&, unsigned) {}
+    void erase(const T&) noexcept {}
+};
+
+template<typename T>
+struct UniqueIndex<T, true> {
+    std::unordered_map<typename UniqueKey<T>::type, unsigned> ids;
+
+    void insert(const T& o, unsigned id) {
+        ids[UniqueKey<T>::of(o)] = id;
+    }
+
+    void erase(const T& o) noexcept {
+        ids.erase(UniqueKey<T>::of(o));
+    }
+
+    unsigned find(const typename UniqueKey<T>::type& key) const noexcept {
+        auto it = ids.find(key);
+        return it != ids.end() ? it->second : 0;
+    }
+};
+
+//实体集合:实体对象按块就地存储,块一经分配不再移动,集合增长后EntityRef<T*>仍然有效
+//标识符从1开始递增且不复用,ids[id-1]记录实体所在槽位;实体销毁后槽位进入空闲列表等待复用,
+//此前保存的EntityRef<T*>地址可能指向复用该槽位的其它实体,使用前须以resolve/find(id)重新解析
 template<typename T>
 struct EntitySet final : public IDataSet, Container<T> {
-    unsigned next{1};
-    std::vector<std::pair<unsigned, std::unique_ptr<T>>> elements;
+    static constexpr unsigned npos = ~0u;
+    static constexpr std::size_t chunk_size = 256;
+
+    struct Chunk {
+        alignas(T) unsigned char buffer[sizeof(T) * chunk_size];
+    };
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::vector<unsigned> ids;//标识符到槽位
+    std::vector<unsigned> owners;//槽位到标识符,0表示空闲
+    std::vector<unsigned> frees;
+    UniqueIndex<T> index;
+
+    EntitySet() = default;
+    EntitySet(const EntitySet&) = delete;
+    EntitySet& operator=(const EntitySet&) = delete;
+
+    ~EntitySet() {
+        for (std::size_t slot = 0; slot < owners.size(); slot++) {
+            if (owners[slot] != 0) {
+                at(slot)->~T();
+            }
+        }
+    }
+
+    T* at(std::size_t slot) noexcept {
+        auto& chunk = *chunks[slot / chunk_size];
+        return std::launder(reinterpret_cast<T*>(chunk.buffer + sizeof(T) * (slot % chunk_size)));
+    }
+
+    const T* at(std::size_t slot) const noexcept {
+        auto& chunk = *chunks[slot / chunk_size];
+        return std::launder(reinterpret_cast<const T*>(chunk.buffer + sizeof(T) * (slot % chunk_size)));
+    }
 
     unsigned create() {
-        elements.emplace_back(std::make_pair(next++, std::unique_ptr<T>{}));
-        return elements.back().first;
+        ids.emplace_back(npos);
+        return static_cast<unsigned>(ids.size());
     }
 
-    EntityRef<T*> assign(unsigned id, std::unique_ptr<T> obj) {
-        //element是有序的,可以考虑二分查找
-        for (auto& [i, v] : elements) {
-            if (i == id) {
-                v = std::move(obj);
-                return { id,v.get() };
-            }
+    EntityRef<T*> assign(unsigned id, T&& obj) {
+        if (id == 0 || id > ids.size()) return {};
+        auto& slot = ids[id - 1];
+        T* vp = nullptr;
+        if (slot != npos) {
+            vp = at(slot);
+            index.erase(*vp);
+            *vp = std::move(obj);
         }
-        return {};
+        else {
+            auto target = allocate();
+            vp = ::new (at(target)) T(std::move(obj));
+            owners[target] = id;
+            slot = target;
+        }
+        index.insert(*vp, id);
+        return { id,vp };
     }
 
     EntityRef<T*> find(unsigned id) noexcept override {
-        for (auto& [i, v] : elements) {
-            if (i == id) {
-                return { id,v.get() };
-            }
-        }
-        return {};
+        if (id == 0 || id > ids.size()) return {};
+        auto slot = ids[id - 1];
+        return { id,slot != npos ? at(slot) : nullptr };
     }
 
     EntityRef<const T*> find(unsigned id) const noexcept override {
-        for (auto& [i, v] : elements) {
-            if (i == id) {
-                return { id,v.get() };
-            }
-        }
-        return {};
+        if (id == 0 || id > ids.size()) return {};
+        auto slot = ids[id - 1];
+        return { id,slot != npos ? at(slot) : nullptr };
+    }
+
+    /// @brief 根据唯一键查找,仅在UniqueKey<T>启用时可用
+    template<typename K>
+    EntityRef<T*> findByKey(const K& key) noexcept {
+        return find(index.find(key));
     }
 
     bool contains(unsigned id) const noexcept  override {
@@ -49,13 +129,41 @@ struct EntitySet final : public IDataSet, Container<T> {
     }
 
     bool destory(unsigned id) override {
-        for (auto& [i, v] : elements) {
-            if (i == id) {
-                v.reset();
-                return true;
+        if (id == 0 || id > ids.size()) return false;
+        auto& slot = ids[id - 1];
+        if (slot != npos) {
+            auto vp = at(slot);
+            index.erase(*vp);
+            vp->~T();
+            owners[slot] = 0;
+            frees.emplace_back(slot);
+            slot = npos;
+        }
+        return true;
+    }
+protected:
+    //按槽位顺序遍历,访问连续内存
+    void visitImpl(void(*fn)(void*, EntityRef<T*>), void* context) override {
+        for (std::size_t slot = 0; slot < owners.size(); slot++) {
+            if (owners[slot] != 0) {
+                fn(context, { owners[slot],at(slot) });
             }
         }
-        return false;
+    }
+private:
+    unsigned allocate() {
+        if (!frees.empty()) {
+            auto slot = frees.back();
+            frees.pop_back();
+            return slot;
+        }
+        auto slot = owners.size();
+        if (slot % chunk_size == 0) {
+            //不使用make_unique,避免清零整块
+            chunks.emplace_back(new Chunk);
+        }
+        owners.emplace_back(0);
+        return static_cast<unsigned>(slot);
     }
 };
 
@@ -63,15 +171,29 @@ class DataSetCluster {
 public:
     template<typename T>
     EntitySet<T>* get() {
-        for (auto& o : m_datasets) {
-            if (o.code == typeid(T).name()) {
-                return dynamic_cast<EntitySet<T>*>(o.v.get());
-            }
+        auto i = TypeIndexOf<T>();
+        if (i >= m_datasets.size()) {
+            m_datasets.resize(i + 1);
+        }
+        auto& o = m_datasets[i];
+        if (!o.v) {
+            o = DataSet{ typeid(T).name(),next++,
+                std::make_unique<EntitySet<T>>()
+            };
         }
-        m_datasets.emplace_back(DataSet{ typeid(T).name(),next++,
-            std::make_unique<EntitySet<T>>()
-            });
-        return dynamic_cast<EntitySet<T>*>(m_datasets.back().v.get());
+        return static_cast<EntitySet<T>*>(o.v.get());
+    }
+private:
+    //类型索引:每种类型首次使用时分配,按索引直接定位数据集
+    static std::size_t NextTypeIndex() noexcept {
+        static std::size_t next{};
+        return next++;
+    }
+
+    template<typename T>
+    static std::size_t TypeIndexOf() noexcept {
+        static const std::size_t index = NextTypeIndex();
+        return index;
     }
 private:
     unsigned next{1};
@@ -88,27 +210,25 @@ EntityRef<Rule*> Rule::Create(Document* doc, std::string code, std::string descr
 {
     auto repo = doc->cluster()->get<Rule>();
     //检查code是否存在
-    for (auto& [i, v] : repo->elements) {
-        if (v && v->code() == code) {
-            return {};
-        }
+    if (repo->findByKey(code)) {
+        return {};
     }
     auto id = repo->create();
-    return repo->assign(id, std::make_unique<Rule>(Rule{ id,code,description,std::move(ports) }));
+    return repo->assign(id, Rule{ id,code,description,std::move(ports) });
 }
 
 EntityRef<Node*> Node::Create(Document* doc, EntityRef<const Rule*> rule, Point position)
 {
     auto repo = doc->cluster()->get<Node>();
     auto id = repo->create();
-    return repo->assign(id, std::make_unique<Node>(Node{ id,rule,position }));
+    return repo->assign(id, Node{ id,rule,position });
 }
 
 EntityRef<Connect*> Connect::Create(Document* doc, EntityRef<const Node*> src, std::string srcPortCode, EntityRef<const Node*> dst, std::string dstPortCode)
 {
     auto repo = doc->cluster()->get<Connect>();
     auto id = repo->create();
-    return repo->assign(id, std::make_unique<Connect>(Connect{ id,src,srcPortCode,dst,dstPortCode }));
+    return repo->assign(id, Connect{ id,src,srcPortCode,dst,dstPortCode });
 }
 
 Document::Document()
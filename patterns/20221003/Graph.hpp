@@ -2,7 +2,10 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <type_traits>
 
+//实体引用:同时保存标识符和地址;标识符不复用,但实体销毁后其槽位会被复用,
+//保存下来的引用在所指实体可能已销毁时,须经Container<T>::resolve重新解析后再解引用
 template<typename T>
 struct EntityRef {
     static_assert(std::is_pointer_v<T>, "std::is_pointer_v<T>");
@@ -33,16 +36,39 @@ public:
 template<typename T>
 class Container :public IContainer {
 public:
+    using IContainer::destory;
+    using IContainer::contains;
+
     bool destory(EntityRef<const T*> vp) {
         return destory(vp.id);
     }
 
+    //标识符不复用,实体存在即说明引用的地址仍然有效
     bool contains(EntityRef<const T*> vp) const noexcept {
         return contains(vp.id);
     }
 
     virtual EntityRef<T*> find(unsigned id) noexcept = 0;
     virtual EntityRef<const T*> find(unsigned id) const noexcept = 0;
+
+    //按标识符重新解析保存下来的引用,实体已销毁时返回空引用,而不是复用其槽位的其它实体
+    EntityRef<T*> resolve(EntityRef<const T*> vp) noexcept {
+        return find(vp.id);
+    }
+
+    EntityRef<const T*> resolve(EntityRef<const T*> vp) const noexcept {
+        return find(vp.id);
+    }
+
+    //遍历所有有效实体,fn以EntityRef<T*>为参数
+    template<typename Fn>
+    void visit(Fn&& fn) {
+        visitImpl([](void* context, EntityRef<T*> vp) {
+            (*static_cast<std::remove_reference_t<Fn>*>(context))(vp);
+            }, const_cast<void*>(static_cast<const void*>(std::addressof(fn))));
+    }
+protected:
+    virtual void visitImpl(void(*fn)(void*, EntityRef<T*>), void* context) = 0;
 };
 
 class Document;
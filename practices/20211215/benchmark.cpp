@@ -0,0 +1,248 @@
+﻿#include "repository.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <thread>
+
+using namespace abc;
+
+struct Position {
+    double x{};
+    double y{};
+};
+
+struct Tag {
+    double weight{};
+};
+
+/// @brief 稀疏集存储的组件
+struct Marker {
+    double weight{};
+};
+
+template<>
+struct abc::sparse_storage<Marker> :std::true_type {};
+
+/// @brief 记录变更的组件
+struct Health {
+    double value{};
+};
+
+template<>
+struct abc::change_tracking<Health> :std::true_type {};
+
+namespace
+{
+    constexpr std::size_t kEntitys = 1000000;
+
+    /// @brief 让存储库地址对外可见,避免编译器认为多轮遍历的结果不变而将其合并
+    repository* g_escaped = nullptr;
+
+    template<typename Fn>
+    void measure(const char* name, double density, Fn&& fn) {
+        fn();//预热,同时让缓存的联合结果就绪
+        constexpr int rounds = 5;
+        double sum = 0.0;
+        double ms = 0.0;
+        for (int i = 0; i < rounds; i++) {
+            auto start = std::chrono::steady_clock::now();
+            sum += fn();
+            auto stop = std::chrono::steady_clock::now();
+            ms += std::chrono::duration<double, std::milli>(stop - start).count();
+        }
+        std::printf("density %6.3f%% %-24s %10.3f ms (checksum %.0f)\n", density * 100.0, name, ms / rounds, sum);
+    }
+
+    void run(double density) {
+        repository repo{};
+        g_escaped = &repo;
+        repo.resize(kEntitys);
+        std::mt19937 engine{ 20211215 };
+        std::uniform_real_distribution<double> dist{ 0.0, 1.0 };
+        for (std::size_t i = 0; i < kEntitys; i++) {
+            auto e = repo.at(i);
+            e.emplace(Position{ 1.0, 2.0 });
+            if (dist(engine) < density) {
+                e.emplace(Tag{ 1.0 });
+                e.emplace(Marker{ 1.0 });
+            }
+        }
+
+        measure("views<Position,Tag>", density, [&]() {
+            double sum = 0.0;
+            for (auto&& e : repo.views<Position, Tag>()) {
+                if (!e.contains<Position, Tag>()) continue;
+                sum += e.view<Position>()->x * e.view<Tag>()->weight;
+            }
+            return sum;
+            });
+        measure("join<Position,Tag>", density, [&]() {
+            double sum = 0.0;
+            for (auto&& e : repo.join<Position, Tag>()) {
+                sum += e.view<Position>()->x * e.view<Tag>()->weight;
+            }
+            return sum;
+            });
+        measure("join<Position,Marker>", density, [&]() {
+            double sum = 0.0;
+            for (auto&& e : repo.join<Position, Marker>()) {
+                sum += e.view<Position>()->x * e.view<Marker>()->weight;
+            }
+            return sum;
+            });
+        measure("group<Position,Tag>", density, [&]() {
+            double sum = 0.0;
+            for (auto&& e : repo.group<Position, Tag>()) {
+                sum += e.view<Position>()->x * e.view<Tag>()->weight;
+            }
+            return sum;
+            });
+    }
+
+    /// @brief 撤销/重做场景:每轮保存一份存储库副本,然后做少量修改
+    template<typename Fn>
+    void run_snapshot(const char* name, Fn&& copy) {
+        repository repo{};
+        g_escaped = &repo;
+        repo.resize(kEntitys);
+        for (std::size_t i = 0; i < kEntitys; i++) {
+            auto e = repo.at(i);
+            e.emplace(Position{ 1.0, 2.0 });
+            if (i % 100 == 0) {
+                e.emplace(Marker{ 1.0 });
+            }
+        }
+
+        constexpr int cycles = 20;
+        constexpr int edits = 16;
+        std::mt19937 engine{ 20211215 };
+        std::uniform_int_distribution<std::size_t> dist{ 0, kEntitys - 1 };
+        std::vector<repository> history;
+        history.reserve(cycles);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < cycles; i++) {
+            history.emplace_back(copy(repo));
+            for (int j = 0; j < edits; j++) {
+                auto e = repo.at(dist(engine));
+                e.emplace(Position{ 3.0, 4.0 });
+                e.erase<Marker>();
+            }
+        }
+        auto stop = std::chrono::steady_clock::now();
+        auto ms = std::chrono::duration<double, std::milli>(stop - start).count();
+        std::printf("%-24s %10.3f ms/cycle (%d edits per cycle)\n", name, ms / cycles, edits);
+    }
+
+    /// @brief 并行遍历:1000万个值,线程数从1增加到硬件并发数
+    void run_parallel() {
+        constexpr std::size_t n = 10000000;
+        repository repo{};
+        g_escaped = &repo;
+        repo.resize(n);
+        for (std::size_t i = 0; i < n; i++) {
+            repo.at(i).emplace(Position{ double(i % 1024), 1.0 });
+        }
+
+        auto update = [](Position& o) {
+            o.x = o.x * 0.5 + o.y;
+            o.y = o.x * 0.25 + 1.0;
+        };
+
+        constexpr int rounds = 5;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            for (auto&& o : repo.values<Position>()) {
+                update(o.value());
+            }
+        }
+        auto stop = std::chrono::steady_clock::now();
+        auto baseline = std::chrono::duration<double, std::milli>(stop - start).count() / rounds;
+        std::printf("values<Position> sequential       %10.3f ms\n", baseline);
+
+        const auto hardware = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+        double single = 0.0;
+        for (std::size_t threads = 1; threads <= hardware; threads *= 2) {
+            work_stealing_pool pool{ threads };
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < rounds; i++) {
+                repo.parallel_for_each<Position>(pool, [&](std::size_t, Position& o) { update(o); });
+            }
+            stop = std::chrono::steady_clock::now();
+            auto ms = std::chrono::duration<double, std::milli>(stop - start).count() / rounds;
+            if (threads == 1) {
+                single = ms;
+            }
+            std::printf("parallel_for_each %2zu thread(s)    %10.3f ms (speedup %.2fx)\n", threads, ms, single / ms);
+            if (threads < hardware && threads * 2 > hardware) {
+                threads = hardware / 2;
+            }
+        }
+    }
+
+    /// @brief 每帧修改部分实体后,使用方全量扫描与只处理增量的对比
+    void run_changes(double ratio) {
+        repository repo{};
+        g_escaped = &repo;
+        repo.resize(kEntitys);
+        for (std::size_t i = 0; i < kEntitys; i++) {
+            repo.at(i).emplace(Health{ 100.0 });
+        }
+
+        std::mt19937 gen{ 42 };
+        std::uniform_int_distribution<std::size_t> pick{ 0, kEntitys - 1 };
+        const auto edits = std::max<std::size_t>(static_cast<std::size_t>(kEntitys * ratio), 1);
+        auto frame = [&]() {
+            for (std::size_t i = 0; i < edits; i++) {
+                auto key = pick(gen);
+                repo.at(key).view<Health>()->value -= 1.0;
+                repo.touch<Health>(key);
+            }
+        };
+
+        constexpr int rounds = 5;
+        double rescan = 0.0;
+        double delta = 0.0;
+        double sum = 0.0;
+        std::vector<double> mirror(kEntitys, 100.0);
+        auto version = repo.change_version<Health>();
+        for (int i = 0; i < rounds; i++) {
+            frame();
+            auto start = std::chrono::steady_clock::now();
+            for (auto&& o : g_escaped->values<Health>()) {
+                mirror[o.key()] = o.value().value;
+            }
+            auto stop = std::chrono::steady_clock::now();
+            rescan += std::chrono::duration<double, std::milli>(stop - start).count();
+
+            start = std::chrono::steady_clock::now();
+            auto changes = g_escaped->changes<Health>(version);
+            for (auto key : changes.modified) {
+                mirror[key] = g_escaped->at(key).view<Health>()->value;
+            }
+            version = changes.version;
+            g_escaped->trim_changes<Health>(version);
+            stop = std::chrono::steady_clock::now();
+            delta += std::chrono::duration<double, std::milli>(stop - start).count();
+            sum += mirror[pick(gen)];
+        }
+        std::printf("changes %.1f%% modified: rescan %10.3f ms, delta %10.3f ms (checksum %g)\n",
+            ratio * 100.0, rescan / rounds, delta / rounds, sum);
+    }
+}
+
+int main() {
+    for (auto density : { 0.5, 0.1, 0.01, 0.001 }) {
+        run(density);
+    }
+
+    run_snapshot("copy + edits", [](const repository& repo) { return repository{ repo }; });
+    run_snapshot("snapshot + edits", [](const repository& repo) { return repo.snapshot(); });
+
+    run_parallel();
+
+    for (auto ratio : { 0.1, 0.01, 0.001 }) {
+        run_changes(ratio);
+    }
+    return 0;
+}
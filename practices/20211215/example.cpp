@@ -8,6 +8,25 @@
 
 using namespace abc;
 
+/// @brief 频繁增删的值类型,采用稀疏集存储
+struct Velocity {
+    double x{};
+    double y{};
+};
+
+template<>
+struct abc::sparse_storage<Velocity> :std::true_type {};
+
+/// @brief 记录速度的变更,使用方只处理两次查询之间的增量
+template<>
+struct abc::change_tracking<Velocity> :std::true_type {};
+
+/// @brief 字符串值建立哈希索引,find/find_all不再线性遍历
+template<>
+struct abc::value_index<std::string> :std::true_type {
+    using type = abc::hash_index<std::string>;
+};
+
 void example(int h, entity_view<> e, double* dVp, std::string* sVp) {
     std::cout << "h:" << h << "\ndV:" << *dVp << "\nsV:" << *sVp << "\n";
 }
@@ -179,6 +198,9 @@ int main(int argc, char** argv) {
     auto it = std::any_of(strings.begin(), strings.end(), [](const auto& v) {  return v.value() == std::string{"liff.cpplang@gmail.com"}; });
 
     auto e = repo.find(std::string{ "liff.cpplang@gmail.com" });
+    for (auto key : repo.find_all(std::string{ "liff.engineer@gmail.com" })) {
+        std::cout << "find_all:" << key << "\n";
+    }
 
     std::vector<int> is{};
     std::vector<std::string> ss{};
@@ -202,7 +224,40 @@ int main(int argc, char** argv) {
         ss.emplace_back(*e.view<std::string>());
     }
 
+    auto velocityVersion = repo.change_version<Velocity>();
+    for (auto&& e : repo) {
+        e.emplace(Velocity{ 1.0, e.key() * 0.5 });
+    }
+    velocityVersion = repo.changes<Velocity>(velocityVersion).version;
+    repo.at(0).erase<Velocity>();
+    if (auto vp = repo.at(1).view<Velocity>()) {
+        vp->x = 1.5;
+        repo.at(1).touch<Velocity>();
+    }
+    {
+        auto delta = repo.changes<Velocity>(velocityVersion);
+        std::cout << "velocity removed:" << delta.removed.size() << " modified:" << delta.modified.size() << "\n";
+        repo.trim_changes<Velocity>(delta.version);
+    }
+    for (auto&& v : repo.values<Velocity>()) {
+        std::cout << "velocity[" << v.key() << "]:" << v.value().y << "\n";
+    }
+
     repository repo1 = repo;
+    //快照共享存储块,修改时才复制
+    repository undo = repo.snapshot();
+    repo.at(1).emplace(Velocity{ 2.0, 2.0 });
+    std::cout << "undo velocity:" << undo.at(1).view<Velocity>()->x << "\n";
+
+    {
+        //移除的实体键会被复用,之前的实体视图通过代数识别为失效
+        auto temp = repo.emplace_back();
+        repo.erase(temp.key());
+        auto reused = repo.emplace_back();
+        std::cout << "reused key:" << reused.key() << " stale:" << !temp << "\n";
+        repo.erase(reused.key());
+        repo.shrink();
+    }
 
     RepositorySerializer serializer{};
     serializer.AddSerializer<int>("intger")
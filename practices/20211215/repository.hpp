@@ -1,10 +1,26 @@
 ﻿#pragma once
 #include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <array>
+#include <bitset>
 #include <memory>
+#include <new>
 #include <string_view>
 #include <tuple>
 #include <algorithm>
+#include <utility>
+#include <numeric>
+#include <limits>
+#include <type_traits>
 #include <cassert>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
 
 namespace abc {
 
@@ -27,106 +43,875 @@ namespace abc {
 
     struct indexed_array_base {
         virtual ~indexed_array_base() = default;
-        virtual void erase(std::size_t index) noexcept = 0;
+        virtual void erase(std::size_t index) = 0;
         virtual std::unique_ptr<indexed_array_base> clone() const = 0;
+        /// @brief 共享存储块的副本,任何一方首次修改某块时才复制该块
+        virtual std::unique_ptr<indexed_array_base> share() const = 0;
+        /// @brief 整理存储并释放空闲内存,之前获取的值地址可能失效
+        virtual void shrink() = 0;
+        /// @brief 复制所有共享的存储块,此后可写访问不再修改存储结构,可由多个线程同时进行
+        virtual void detach() = 0;
+
+        /// @brief 结构版本:增加或移除值时递增,值的修改不影响
+        std::size_t version() const noexcept { return m_version; }
+
+        /// @brief 冻结期间(并行遍历时)不允许增删值,增删时抛出std::logic_error且不做任何修改
+        void freeze(bool on) noexcept { m_frozen = on; }
+        bool frozen() const noexcept { return m_frozen; }
+
+        void ensure_unfrozen() const {
+            if (m_frozen) {
+                throw std::logic_error("cannot add or remove values while the value array is frozen");
+            }
+        }
+    protected:
+        std::size_t m_version{};
+        bool        m_frozen{};
+    };
+
+    /// @brief 值数组存储策略:特化为std::true_type的值类型使用稀疏集存储
+    /// 稀疏集存储的值紧凑连续、增删为O(1)、内存与值数量成正比,但增删会使已获取的值地址失效
+    template<typename T, typename E = void>
+    struct sparse_storage : std::false_type {};
+
+    namespace im {
+        /// @brief 值到实体键的多值映射,哈希索引与有序索引只有底层容器不同
+        template<typename Map>
+        class multi_index {
+        public:
+            using value_type = typename Map::key_type;
+            static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+            void insert(const value_type& v, std::size_t key) { m_keys.emplace(v, key); }
+
+            void erase(const value_type& v, std::size_t key) noexcept {
+                auto [first, last] = m_keys.equal_range(v);
+                for (; first != last; ++first) {
+                    if (first->second == key) {
+                        m_keys.erase(first);
+                        return;
+                    }
+                }
+            }
+
+            void clear() noexcept { m_keys.clear(); }
+
+            /// @brief 查找值对应的实体键,不存在时返回npos
+            std::size_t find(const value_type& v) const {
+                auto it = m_keys.find(v);
+                return it != m_keys.end() ? it->second : npos;
+            }
+
+            template<typename Fn>
+            void for_each(const value_type& v, Fn&& fn) const {
+                auto [first, last] = m_keys.equal_range(v);
+                for (; first != last; ++first) {
+                    fn(first->second);
+                }
+            }
+        private:
+            Map m_keys;
+        };
+    }
+
+    /// @brief 哈希索引:值到实体键的多值映射,查找为O(1),find返回任意一个实体键
+    template<typename T, typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>>
+    class hash_index :public im::multi_index<std::unordered_multimap<T, std::size_t, Hash, KeyEqual>> {};
+
+    /// @brief 有序索引:值到实体键的多值映射,查找为O(log n),相等值按加入顺序排列,find返回第一个实体键
+    template<typename T, typename Compare = std::less<T>>
+    class sorted_index :public im::multi_index<std::multimap<T, std::size_t, Compare>> {};
+
+    /// @brief 值索引策略:特化为std::true_type并以type指定hash_index或sorted_index,即可为该值类型维护二级索引
+    /// 索引随emplace/erase维护;通过值地址直接修改已索引的值后,需调用repository::reindex<T>()
+    template<typename T, typename E = void>
+    struct value_index : std::false_type {};
+
+    namespace im {
+        /// @brief 值数组持有的二级索引,未启用时不做任何维护
+        template<typename T, bool Enable = value_index<T>::value>
+        struct index_holder {
+            void insert(const T&, std::size_t) noexcept {}
+            void erase(const T&, std::size_t) noexcept {}
+            void clear() noexcept {}
+            index_holder clone() const noexcept { return {}; }
+        };
+
+        /// @brief 索引与存储块一样在快照间共享,修改时复制
+        template<typename T>
+        struct index_holder<T, true> {
+            using index_type = typename value_index<T>::type;
+            std::shared_ptr<index_type> index{ std::make_shared<index_type>() };
+
+            const index_type& get() const noexcept { return *index; }
+            void insert(const T& v, std::size_t key) { writable().insert(v, key); }
+            void erase(const T& v, std::size_t key) { writable().erase(v, key); }
+            void clear() { writable().clear(); }
+            index_holder clone() const { return index_holder{ std::make_shared<index_type>(*index) }; }
+
+            index_type& writable() {
+                if (index.use_count() > 1) {
+                    index = std::make_shared<index_type>(*index);
+                }
+                return *index;
+            }
+        };
+    }
+
+    /// @brief 变更跟踪策略:特化为std::true_type的值类型记录增加、修改、移除的实体键
+    /// 通过值地址直接修改值不会被记录,需调用touch标记
+    template<typename T, typename E = void>
+    struct change_tracking : std::false_type {};
+
+    enum class change_kind : unsigned char {
+        added,
+        modified,
+        removed,
     };
 
-    /// @brief 内存连续且一直有效的值数组(遍历性能略差)
+    /// @brief 自某版本以来的净变更:同一实体的多次变更合并为一次,各集合按键有序;
+    /// 增加后又移除的实体不出现,移除后又增加的实体(值已替换)同时出现在removed与added中
+    struct change_set {
+        std::size_t version{};//当前变更版本,作为下次查询的起点
+        bool complete{ true };//查询起点早于保留的记录时为false,需全量处理
+        std::vector<std::size_t> added;
+        std::vector<std::size_t> modified;
+        std::vector<std::size_t> removed;
+    };
+
+    namespace im {
+        /// @brief 值数组持有的变更记录,未启用时不做任何维护
+        template<typename T, bool Enable = change_tracking<T>::value>
+        struct change_log {
+            void record(std::size_t, change_kind) noexcept {}
+            change_log clone() const noexcept { return {}; }
+        };
+
+        /// @brief 只追加的变更记录,第i条记录的版本为base+i+1;与存储块一样在快照间共享,修改时复制
+        template<typename T>
+        struct change_log<T, true> {
+            struct entry {
+                std::size_t key;
+                change_kind kind;
+            };
+            struct log_type {
+                std::vector<entry> entries;
+                std::size_t base{};
+                std::size_t keys{};//记录过的最大键+1
+            };
+            std::shared_ptr<log_type> log{ std::make_shared<log_type>() };
+
+            std::size_t version() const noexcept { return log->base + log->entries.size(); }
+
+            void record(std::size_t key, change_kind kind) {
+                auto&& o = writable();
+                o.entries.emplace_back(entry{ key,kind });
+                o.keys = std::max(o.keys, key + 1);
+            }
+
+            change_log clone() const { return change_log{ std::make_shared<log_type>(*log) }; }
+
+            /// @brief 丢弃版本不大于v的记录
+            void trim(std::size_t v) {
+                if (v <= log->base) return;
+                auto&& o = writable();
+                auto n = std::min(v - o.base, o.entries.size());
+                o.entries.erase(o.entries.begin(), o.entries.begin() + n);
+                o.base += n;
+            }
+
+            change_set collect(std::size_t since) const {
+                change_set result{};
+                result.version = version();
+                if (since < log->base) {
+                    result.complete = false;
+                    return result;
+                }
+                //removed标识期间是否移除过,原有的值被移除后又增加时报告为移除加增加,而非修改
+                auto classify = [&](std::size_t key, change_kind first, change_kind last, bool removed) {
+                    if (first == change_kind::added) {
+                        if (last != change_kind::removed) {
+                            result.added.emplace_back(key);
+                        }
+                    }
+                    else if (last == change_kind::removed) {
+                        result.removed.emplace_back(key);
+                    }
+                    else if (removed) {
+                        result.removed.emplace_back(key);
+                        result.added.emplace_back(key);
+                    }
+                    else {
+                        result.modified.emplace_back(key);
+                    }
+                };
+
+                auto&& entries = log->entries;
+                auto first = entries.begin() + std::min(since - log->base, entries.size());
+                auto n = static_cast<std::size_t>(entries.end() - first);
+                if (n * 32 >= log->keys) {
+                    //变更较多时按键建表,每个键一字节记录首末变更及是否移除过
+                    constexpr unsigned removed_bit = 1u << 4;
+                    std::vector<unsigned char> marks(log->keys);
+                    for (auto it = first; it != entries.end(); ++it) {
+                        auto&& mark = marks[it->key];
+                        auto kind = static_cast<unsigned>(it->kind);
+                        auto bits = (it->kind == change_kind::removed) ? removed_bit : 0u;
+                        mark = (mark == 0) ? static_cast<unsigned char>(((kind + 1) << 2) | kind | bits) : static_cast<unsigned char>((mark & ~3u) | kind | bits);
+                    }
+                    for (std::size_t key = 0; key < marks.size(); key++) {
+                        if (auto mark = marks[key]) {
+                            classify(key, static_cast<change_kind>(((mark >> 2) & 3u) - 1), static_cast<change_kind>(mark & 3u), (mark & removed_bit) != 0);
+                        }
+                    }
+                }
+                else {
+                    //变更较少时按键稳定排序后合并
+                    std::vector<entry> sorted(first, entries.end());
+                    std::stable_sort(sorted.begin(), sorted.end(), [](auto&& lhs, auto&& rhs) { return lhs.key < rhs.key; });
+                    for (std::size_t i = 0; i < sorted.size();) {
+                        auto j = i;
+                        auto removed = (sorted[i].kind == change_kind::removed);
+                        while (j + 1 < sorted.size() && sorted[j + 1].key == sorted[i].key) {
+                            j++;
+                            removed = removed || (sorted[j].kind == change_kind::removed);
+                        }
+                        classify(sorted[i].key, sorted[i].kind, sorted[j].kind, removed);
+                        i = j + 1;
+                    }
+                }
+                return result;
+            }
+
+            log_type& writable() {
+                if (log.use_count() > 1) {
+                    log = std::make_shared<log_type>(*log);
+                }
+                return *log;
+            }
+        };
+    }
+
+    template<typename T, bool Sparse = sparse_storage<T>::value>
+    struct indexed_array;
+
+    /// @brief 按键分页存储、值地址一直有效的值数组(遍历性能略差)
+    /// 页只预留存储空间,值在放入时才构造;页以引用计数在快照间共享,
+    /// 首次通过可写接口访问时复制该页,此后本存储库在该页上已获取的值地址失效;只读访问走const接口,不会复制
     template<typename T>
-    struct indexed_array final :public indexed_array_base
+    struct indexed_array<T, false> final :public indexed_array_base
     {
-        static_assert(!std::is_same_v<T, bool>, "cann't support because std::vector<bool>");
+        static constexpr bool dense = false;
+        static constexpr std::size_t page_size = 256;
+        /// @brief 并行遍历时的任务粒度,与页对齐
+        static constexpr std::size_t block_size = 16 * page_size;
+
         explicit indexed_array(std::size_t capacity)
         {
-            auto block = std::make_unique<std::vector<T>>();
-            block->reserve(capacity);
-            m_blocks.emplace_back(std::move(block));
-            m_pointers.reserve(capacity);
+            m_pages.reserve((capacity + page_size - 1) / page_size);
         }
 
-        std::size_t size() const noexcept { return m_pointers.size(); }
+        std::size_t size() const noexcept { return m_size; }
 
-        bool empty() const noexcept {
-            return std::all_of(m_pointers.begin(), m_pointers.end(), [](auto v) { return v == nullptr; });
-        };
+        /// @brief 值数量
+        std::size_t count() const noexcept { return m_count; }
+
+        bool empty() const noexcept { return m_count == 0; };
 
         bool contains(std::size_t index) const noexcept {
-            if (index >= m_pointers.size()) return false;
-            return m_pointers[index] != nullptr;
+            if (index >= m_size) return false;
+            auto&& page = m_pages[index / page_size];
+            return page != nullptr && page->used[index % page_size];
         }
 
         template<typename... Args>
         void emplace(std::size_t index, Args&&... args) {
-            if (index + 1 >= m_pointers.size()) {
-                m_pointers.resize(index + 1, nullptr);
+            if (!contains(index)) {
+                ensure_unfrozen();
             }
-
-            auto&& pointer = m_pointers[index];
-            if (pointer == nullptr) {
-                pointer = alloc(std::forward<Args>(args)...);
+            auto&& page = writable_page(index / page_size);
+            auto offset = index % page_size;
+            if (page.used[offset]) {
+                auto vp = page.get(offset);
+                m_index.erase(*vp, index);
+                *vp = T{ std::forward<Args>(args)... };
+                m_index.insert(*vp, index);
+                m_log.record(index, change_kind::modified);
             }
             else {
-                *pointer = T{ std::forward<Args>(args)... };
+                auto vp = page.construct(offset, std::forward<Args>(args)...);
+                m_index.insert(*vp, index);
+                m_size = std::max(m_size, index + 1);
+                m_count++;
+                m_version++;
+                m_log.record(index, change_kind::added);
             }
         }
 
+        /// @brief 可写访问:值所在页被共享时先复制该页
         std::add_pointer_t<T> at(std::size_t i) {
-            if (i < m_pointers.size()) return m_pointers.at(i);
-            return nullptr;
+            if (!contains(i)) return nullptr;
+            return writable_page(i / page_size).get(i % page_size);
+        }
+
+        std::add_pointer_t<const T> at(std::size_t i) const noexcept {
+            if (!contains(i)) return nullptr;
+            return std::as_const(*m_pages[i / page_size]).get(i % page_size);
+        }
+
+        std::add_pointer_t<T> operator[](std::size_t i) { return at(i); }
+        std::add_pointer_t<const T> operator[](std::size_t i) const noexcept { return at(i); }
+
+        /// @brief 移除值,共享的页需先复制,因而可能抛出内存分配异常
+        void erase(std::size_t index) override {
+            if (!contains(index)) return;
+            ensure_unfrozen();
+            auto&& page = writable_page(index / page_size);
+            auto offset = index % page_size;
+            m_index.erase(*page.get(offset), index);
+            page.destroy(offset);
+            m_count--;
+            m_version++;
+            m_log.record(index, change_kind::removed);
+        }
+
+        std::unique_ptr<indexed_array_base> clone() const override {
+            auto result = std::make_unique<indexed_array<T>>(0);
+            result->m_pages.reserve(m_pages.size());
+            for (auto&& page : m_pages) {
+                result->m_pages.emplace_back(page ? std::make_shared<page_type>(*page) : nullptr);
+            }
+            result->m_size = m_size;
+            result->m_count = m_count;
+            result->m_index = m_index.clone();
+            result->m_log = m_log.clone();
+            return result;
         }
 
-        std::add_pointer_t<T> operator[](std::size_t i) noexcept { return m_pointers[i]; }
+        std::unique_ptr<indexed_array_base> share() const override {
+            auto result = std::make_unique<indexed_array<T>>(0);
+            result->m_pages = m_pages;
+            result->m_index = m_index;
+            result->m_log = m_log;
+            result->m_size = m_size;
+            result->m_count = m_count;
+            result->m_version = m_version;
+            return result;
+        }
 
-        void erase(std::size_t index) noexcept override {
-            if (index < m_pointers.size()) {
-                auto&& pointer = m_pointers[index];
-                if (pointer != nullptr) {
-                    std::exchange(*pointer, T{});
-                    pointer = nullptr;
+        void detach() override {
+            for (auto&& page : m_pages) {
+                if (page != nullptr && page.use_count() > 1) {
+                    page = std::make_shared<page_type>(*page);
                 }
             }
         }
 
-        std::unique_ptr<indexed_array_base> clone() const override {
-            //clone时计算出合适的大小,避免重复内存申请
-            std::size_t n = 0;
-            for (std::size_t i = 0; i < m_pointers.size(); i++) {
-                if (m_pointers[i] != nullptr) {
-                    n++;
+        /// @brief 释放没有值的页
+        void shrink() override {
+            for (auto&& page : m_pages) {
+                if (page != nullptr && page->used.none()) {
+                    page.reset();
                 }
             }
-            auto result = std::make_unique<indexed_array<T>>(n);
+            while (!m_pages.empty() && m_pages.back() == nullptr) {
+                m_pages.pop_back();
+            }
+            m_pages.shrink_to_fit();
+
+            m_size = 0;
+            if (!m_pages.empty()) {
+                auto&& used = m_pages.back()->used;
+                for (auto i = page_size; i > 0; i--) {
+                    if (used[i - 1]) {
+                        m_size = (m_pages.size() - 1) * page_size + i;
+                        break;
+                    }
+                }
+            }
+        }
 
-            //指针直接设置为相同大小
-            result->m_pointers.resize(m_pointers.size(), nullptr);
-            //填充数据及指针
-            auto dst = result->m_blocks.back().get();
-            for (std::size_t i = 0; i < m_pointers.size(); i++) {
-                if (m_pointers[i] != nullptr) {
-                    dst->emplace_back(T{ *m_pointers[i] });
-                    result->m_pointers[i] = std::addressof(dst->back());
+        /// @brief 二级索引,仅在value_index<T>启用时可用
+        decltype(auto) index() const noexcept { return m_index.get(); }
+
+        /// @brief 依据当前值重建二级索引
+        void reindex() {
+            m_index.clear();
+            for (std::size_t i = 0; i < m_size; i++) {
+                if (auto vp = std::as_const(*this).at(i)) {
+                    m_index.insert(*vp, i);
                 }
             }
-            return result;
         }
-    protected:
+
+        /// @brief 变更记录,仅在change_tracking<T>启用时可用
+        decltype(auto) changes() const noexcept { return (m_log); }
+        decltype(auto) changes() noexcept { return (m_log); }
+
+        /// @brief 标记通过值地址直接修改的值
+        void touch(std::size_t index) {
+            if (contains(index)) {
+                m_log.record(index, change_kind::modified);
+            }
+        }
+
+        /// @brief 遍历槽位:与键一致,槽位可能为空
+        std::size_t slots() const noexcept { return m_size; }
+        std::size_t key_at(std::size_t slot) const noexcept { return slot; }
+        std::add_pointer_t<T> value_at(std::size_t slot) { return at(slot); }
+        std::add_pointer_t<const T> value_at(std::size_t slot) const noexcept { return at(slot); }
+    private:
+        /// @brief 页只预留存储空间,值在使用时才构造,复制页时只复制已有的值
+        struct page_type {
+            std::bitset<page_size> used{};
+            std::aligned_storage_t<sizeof(T), alignof(T)> storage[page_size];
+
+            page_type() noexcept {}
+            page_type(const page_type& other) {
+                try {
+                    for (std::size_t i = 0; i < page_size; i++) {
+                        if (other.used[i]) {
+                            construct(i, *other.get(i));
+                        }
+                    }
+                }
+                catch (...) {
+                    clear();
+                    throw;
+                }
+            }
+            page_type& operator=(const page_type&) = delete;
+            ~page_type() { clear(); }
+
+            T* get(std::size_t i) noexcept { return std::launder(reinterpret_cast<T*>(&storage[i])); }
+            const T* get(std::size_t i) const noexcept { return std::launder(reinterpret_cast<const T*>(&storage[i])); }
+
+            template<typename... Args>
+            T* construct(std::size_t i, Args&&... args) {
+                auto vp = ::new (static_cast<void*>(&storage[i])) T(std::forward<Args>(args)...);
+                used.set(i);
+                return vp;
+            }
+
+            void destroy(std::size_t i) noexcept {
+                std::destroy_at(get(i));
+                used.reset(i);
+            }
+
+            void clear() noexcept {
+                for (std::size_t i = 0; i < page_size; i++) {
+                    if (used[i]) {
+                        destroy(i);
+                    }
+                }
+            }
+        };
+
+        page_type& writable_page(std::size_t i) {
+            if (i >= m_pages.size()) {
+                m_pages.resize(i + 1);
+            }
+            auto&& page = m_pages[i];
+            if (page == nullptr) {
+                page = std::make_shared<page_type>();
+            }
+            else if (page.use_count() > 1) {
+                page = std::make_shared<page_type>(*page);
+            }
+            return *page;
+        }
+    private:
+        std::vector<std::shared_ptr<page_type>> m_pages;
+        std::size_t m_size{};
+        std::size_t m_count{};
+        im::index_holder<T> m_index;
+        im::change_log<T> m_log;
+    };
+
+    /// @brief 稀疏集值数组:值与键紧凑存储,稀疏索引按页分配
+    /// 紧凑存储整体、稀疏索引按页在快照间共享,首次修改时复制
+    template<typename T>
+    struct indexed_array<T, true> final :public indexed_array_base
+    {
+        static_assert(!std::is_same_v<T, bool>, "cann't support because std::vector<bool>");
+        static constexpr bool dense = true;
+        static constexpr std::size_t page_size = 1024;
+        /// @brief 并行遍历时的任务粒度(紧凑存储的槽位数)
+        static constexpr std::size_t block_size = 4096;
+        static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+        explicit indexed_array(std::size_t capacity)
+            :m_dense(std::make_shared<dense_type>())
+        {
+            m_dense->values.reserve(capacity);
+            m_dense->keys.reserve(capacity);
+        }
+
+        /// @brief 值数量(非键范围)
+        std::size_t size() const noexcept { return m_dense->values.size(); }
+
+        std::size_t count() const noexcept { return m_dense->values.size(); }
+
+        bool empty() const noexcept { return m_dense->values.empty(); }
+
+        bool contains(std::size_t index) const noexcept {
+            return position(index) != npos;
+        }
+
         template<typename... Args>
-        std::add_pointer_t<T> alloc(Args&&... args) {
-            auto  current = m_blocks.back().get();
-            const auto capacity = current->capacity();
-            const auto size = current->size();
-            if (size + 1 > capacity) {
-                auto block = std::make_unique<std::vector<T>>();
-                block->reserve(capacity * 2);
-                m_blocks.emplace_back(std::move(block));
-                current = m_blocks.back().get();
-            }
-            current->emplace_back(std::forward<Args>(args)...);
-            return std::addressof(current->back());
+        void emplace(std::size_t index, Args&&... args) {
+            auto pos = position(index);
+            if (pos == npos) {
+                ensure_unfrozen();
+            }
+            auto&& dense = writable();
+            if (pos == npos) {
+                dense.values.emplace_back(std::forward<Args>(args)...);
+                dense.keys.emplace_back(index);
+                locate(index) = dense.values.size() - 1;
+                m_index.insert(dense.values.back(), index);
+                m_version++;
+                m_log.record(index, change_kind::added);
+            }
+            else {
+                m_index.erase(dense.values[pos], index);
+                dense.values[pos] = T{ std::forward<Args>(args)... };
+                m_index.insert(dense.values[pos], index);
+                m_log.record(index, change_kind::modified);
+            }
+        }
+
+        /// @brief 可写访问:紧凑存储被共享时先复制
+        std::add_pointer_t<T> at(std::size_t i) {
+            auto pos = position(i);
+            if (pos == npos) return nullptr;
+            return std::addressof(writable().values[pos]);
+        }
+
+        std::add_pointer_t<const T> at(std::size_t i) const noexcept {
+            auto pos = position(i);
+            if (pos == npos) return nullptr;
+            return std::addressof(m_dense->values[pos]);
+        }
+
+        std::add_pointer_t<T> operator[](std::size_t i) { return at(i); }
+        std::add_pointer_t<const T> operator[](std::size_t i) const noexcept { return at(i); }
+
+        /// @brief 以末尾值填补被移除值的位置;共享的存储需先复制,因而可能抛出内存分配异常
+        void erase(std::size_t index) override {
+            auto pos = position(index);
+            if (pos == npos) return;
+            ensure_unfrozen();
+            auto&& dense = writable();
+            m_index.erase(dense.values[pos], index);
+            auto last = dense.values.size() - 1;
+            if (pos != last) {
+                dense.values[pos] = std::move(dense.values[last]);
+                dense.keys[pos] = dense.keys[last];
+                locate(dense.keys[pos]) = pos;
+            }
+            dense.values.pop_back();
+            dense.keys.pop_back();
+            locate(index) = npos;
+            m_version++;
+            m_log.record(index, change_kind::removed);
+        }
+
+        std::unique_ptr<indexed_array_base> clone() const override {
+            auto result = std::make_unique<indexed_array<T>>(0);
+            result->m_dense = std::make_shared<dense_type>(*m_dense);
+            result->m_index = m_index.clone();
+            result->m_log = m_log.clone();
+            result->m_pages.reserve(m_pages.size());
+            for (auto&& page : m_pages) {
+                result->m_pages.emplace_back(page ? std::make_shared<page_type>(*page) : nullptr);
+            }
+            return result;
+        }
+
+        std::unique_ptr<indexed_array_base> share() const override {
+            auto result = std::make_unique<indexed_array<T>>(0);
+            result->m_dense = m_dense;
+            result->m_pages = m_pages;
+            result->m_index = m_index;
+            result->m_log = m_log;
+            result->m_version = m_version;
+            return result;
+        }
+
+        void detach() override {
+            writable();
+        }
+
+        /// @brief 按键重排紧凑存储以恢复遍历的访问局部性,并释放多余容量及空的索引页
+        void shrink() override {
+            auto&& keys = m_dense->keys;
+            if (!std::is_sorted(keys.begin(), keys.end()) || keys.capacity() != keys.size()) {
+                auto&& dense = writable();
+                std::vector<std::size_t> order(dense.keys.size());
+                std::iota(order.begin(), order.end(), std::size_t{});
+                std::sort(order.begin(), order.end(), [&](auto lhs, auto rhs) { return dense.keys[lhs] < dense.keys[rhs]; });
+
+                dense_type result{};
+                result.values.reserve(order.size());
+                result.keys.reserve(order.size());
+                for (auto i : order) {
+                    result.values.emplace_back(std::move(dense.values[i]));
+                    result.keys.emplace_back(dense.keys[i]);
+                }
+                dense = std::move(result);
+                for (std::size_t i = 0; i < dense.keys.size(); i++) {
+                    locate(dense.keys[i]) = i;
+                }
+            }
+
+            for (auto&& page : m_pages) {
+                if (page != nullptr && std::all_of(page->begin(), page->end(), [](auto v) { return v == npos; })) {
+                    page.reset();
+                }
+            }
+            while (!m_pages.empty() && m_pages.back() == nullptr) {
+                m_pages.pop_back();
+            }
+            m_pages.shrink_to_fit();
+        }
+
+        /// @brief 二级索引,仅在value_index<T>启用时可用
+        decltype(auto) index() const noexcept { return m_index.get(); }
+
+        /// @brief 依据当前值重建二级索引
+        void reindex() {
+            m_index.clear();
+            for (std::size_t i = 0; i < m_dense->values.size(); i++) {
+                m_index.insert(m_dense->values[i], m_dense->keys[i]);
+            }
+        }
+
+        /// @brief 变更记录,仅在change_tracking<T>启用时可用
+        decltype(auto) changes() const noexcept { return (m_log); }
+        decltype(auto) changes() noexcept { return (m_log); }
+
+        /// @brief 标记通过值地址直接修改的值
+        void touch(std::size_t index) {
+            if (contains(index)) {
+                m_log.record(index, change_kind::modified);
+            }
+        }
+
+        /// @brief 遍历槽位:即紧凑存储的位置,槽位不会为空
+        std::size_t slots() const noexcept { return m_dense->values.size(); }
+        std::size_t key_at(std::size_t slot) const noexcept { return m_dense->keys[slot]; }
+        std::add_pointer_t<T> value_at(std::size_t slot) { return writable().values.data() + slot; }
+        std::add_pointer_t<const T> value_at(std::size_t slot) const noexcept { return m_dense->values.data() + slot; }
+    private:
+        using page_type = std::array<std::size_t, page_size>;
+
+        struct dense_type {
+            std::vector<T> values;
+            std::vector<std::size_t> keys;
+        };
+
+        dense_type& writable() {
+            if (m_dense.use_count() > 1) {
+                m_dense = std::make_shared<dense_type>(*m_dense);
+            }
+            return *m_dense;
+        }
+
+        std::size_t position(std::size_t index) const noexcept {
+            auto page = index / page_size;
+            if (page >= m_pages.size() || m_pages[page] == nullptr) return npos;
+            return (*m_pages[page])[index % page_size];
+        }
+
+        std::size_t& locate(std::size_t index) {
+            auto page = index / page_size;
+            if (page >= m_pages.size()) {
+                m_pages.resize(page + 1);
+            }
+            auto&& vp = m_pages[page];
+            if (vp == nullptr) {
+                vp = std::make_shared<page_type>();
+                vp->fill(npos);
+            }
+            else if (vp.use_count() > 1) {
+                vp = std::make_shared<page_type>(*vp);
+            }
+            return (*vp)[index % page_size];
         }
     private:
-        std::vector<std::unique_ptr<std::vector<T>>> m_blocks;
-        std::vector<std::add_pointer_t<T>> m_pointers;
+        std::shared_ptr<dense_type> m_dense;
+        std::vector<std::shared_ptr<page_type>> m_pages;
+        im::index_holder<T> m_index;
+        im::change_log<T> m_log;
+    };
+
+    /// @brief 工作窃取线程池:每个线程持有一段连续的块范围,从前端逐块执行,
+    /// 自身范围耗尽时从其它线程范围的后端窃取一半;调用线程也参与执行
+    class work_stealing_pool {
+    public:
+        explicit work_stealing_pool(std::size_t threads = std::thread::hardware_concurrency())
+            :m_workers(std::max<std::size_t>(threads, 1))
+        {
+            for (std::size_t i = 1; i < m_workers.size(); i++) {
+                m_threads.emplace_back([this, i]() { loop(i); });
+            }
+        }
+
+        work_stealing_pool(const work_stealing_pool&) = delete;
+        work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+        ~work_stealing_pool() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_wakeup.notify_all();
+            for (auto&& o : m_threads) {
+                o.join();
+            }
+        }
+
+        /// @brief 线程数量(含调用线程)
+        std::size_t size() const noexcept { return m_workers.size(); }
+
+        /// @brief 进程内共享的线程池,线程数量与硬件并发数一致
+        static work_stealing_pool& shared() {
+            static work_stealing_pool pool{};
+            return pool;
+        }
+
+        /// @brief 当前线程是否正在执行本线程池的任务
+        bool running() const noexcept { return current() == this; }
+
+        /// @brief 对[0,blocks)中的每个块调用一次fn(block),全部完成后返回;异常在完成后重新抛出
+        /// 不可在fn中再次调用同一线程池的run(会在m_run上死锁),此时抛出std::logic_error
+        template<typename Fn>
+        void run(std::size_t blocks, Fn&& fn) {
+            if (running()) {
+                throw std::logic_error("work_stealing_pool::run cannot be called from its own tasks");
+            }
+            if (blocks == 0) return;
+            std::lock_guard<std::mutex> guard(m_run);
+            auto n = m_workers.size();
+            for (std::size_t i = 0; i < n; i++) {
+                std::lock_guard<std::mutex> lock(m_workers[i].mutex);
+                m_workers[i].first = blocks * i / n;
+                m_workers[i].last = blocks * (i + 1) / n;
+            }
+            m_context = std::addressof(fn);
+            m_invoke = [](void* context, std::size_t block) {
+                (*static_cast<std::remove_reference_t<Fn>*>(context))(block);
+            };
+            m_error = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_active = n - 1;
+                m_job++;
+            }
+            m_wakeup.notify_all();
+            {
+                auto previous = std::exchange(current(), this);
+                work(0);
+                current() = previous;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [&]() { return m_active == 0; });
+            if (m_error) {
+                std::rethrow_exception(m_error);
+            }
+        }
+    private:
+        struct alignas(64) worker {
+            std::mutex  mutex;
+            std::size_t first{};
+            std::size_t last{};
+        };
+
+        /// @brief 当前线程正在为之执行任务的线程池
+        static const work_stealing_pool*& current() noexcept {
+            static thread_local const work_stealing_pool* pool{};
+            return pool;
+        }
+
+        void loop(std::size_t index) {
+            current() = this;
+            std::size_t job = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wakeup.wait(lock, [&]() { return m_stop || m_job != job; });
+                    if (m_stop) return;
+                    job = m_job;
+                }
+                work(index);
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_active--;
+                }
+                m_done.notify_one();
+            }
+        }
+
+        bool take(std::size_t index, std::size_t& block) {
+            auto&& self = m_workers[index];
+            std::lock_guard<std::mutex> lock(self.mutex);
+            if (self.first == self.last) return false;
+            block = self.first++;
+            return true;
+        }
+
+        bool steal(std::size_t index) {
+            auto n = m_workers.size();
+            for (std::size_t i = 1; i < n; i++) {
+                auto&& victim = m_workers[(index + i) % n];
+                std::size_t first{};
+                std::size_t last{};
+                {
+                    std::lock_guard<std::mutex> lock(victim.mutex);
+                    if (victim.first == victim.last) continue;
+                    //窃取后半段,仅剩一块时窃取该块
+                    first = victim.first + (victim.last - victim.first) / 2;
+                    last = victim.last;
+                    victim.last = first;
+                }
+                auto&& self = m_workers[index];
+                std::lock_guard<std::mutex> lock(self.mutex);
+                self.first = first;
+                self.last = last;
+                return true;
+            }
+            return false;
+        }
+
+        void work(std::size_t index) {
+            std::size_t block{};
+            while (take(index, block) || (steal(index) && take(index, block))) {
+                try {
+                    m_invoke(m_context, block);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (!m_error) {
+                        m_error = std::current_exception();
+                    }
+                }
+            }
+        }
+    private:
+        std::vector<worker>      m_workers;
+        std::vector<std::thread> m_threads;
+        std::mutex               m_run;
+        std::mutex               m_mutex;
+        std::condition_variable  m_wakeup;
+        std::condition_variable  m_done;
+        std::size_t              m_job{};
+        std::size_t              m_active{};
+        bool                     m_stop{};
+        void*                    m_context{};
+        void (*m_invoke)(void*, std::size_t) {};
+        std::exception_ptr       m_error;
     };
 
     class repository;
@@ -172,24 +957,24 @@ namespace abc {
 
         template<typename E, typename T>
         void project_to(E& e, T*& vp) {
-            vp = e.view<T>();
+            vp = e.template view<T>();
         }
 
         template<typename E, typename T>
         void project_to(E& e, T& v) {
-            if (auto vp = e.view<T>()) {
+            if (auto vp = std::as_const(e).template view<T>()) {
                 v = *vp;
             }
         }
 
         template<typename E, typename T, typename U>
         void project_to(E& e, pointer_tie<T, U>& o) {
-            o.vp = e.view<T>();
+            o.vp = e.template view<T>();
         }
 
         template<typename E, typename T, typename U>
         void project_to(E& e, value_tie<T, U>& o) {
-            if (auto vp = e.view<T>()) {
+            if (auto vp = std::as_const(e).template view<T>()) {
                 o.v = *vp;
             }
         }
@@ -213,20 +998,25 @@ namespace abc {
     class entity_view {
         archetype<Ts...> m_op;
         std::size_t      m_key{ std::numeric_limits<std::size_t>::max() };
+        std::size_t      m_generation{ std::numeric_limits<std::size_t>::max() };
     public:
         entity_view() = default;
-        entity_view(archetype<Ts...> op, std::size_t key) :m_op(std::move(op)), m_key(key) {};
-        entity_view(repository& repo, std::size_t key) :m_op(repo), m_key(key) {};
+        entity_view(archetype<Ts...> op, std::size_t key);
+        entity_view(repository& repo, std::size_t key);
 
         inline std::size_t key() const noexcept { return m_key; };
-        inline void bind(std::size_t key) noexcept { m_key = key; };
+        /// @brief 绑定时实体的代数,实体被移除(键可能被复用)后视图即失效
+        inline std::size_t generation() const noexcept { return m_generation; };
+        inline void bind(std::size_t key) noexcept;
         inline repository* container() const noexcept { return m_op.container(); }
 
+        /// @brief 视图有效:实体存在且代数与绑定时一致;以下访问在视图失效后不再读写值
         explicit operator bool() const noexcept;
 
         template<typename T, typename... Us>
         bool contains() const noexcept {
-            auto h = m_op.store<T>();
+            if (!*this) return false;
+            auto h = m_op.template store<T>();
             if (h == nullptr || !h->contains(key())) return false;
             if constexpr (sizeof...(Us) > 0) {
                 return contains<Us...>();
@@ -236,7 +1026,8 @@ namespace abc {
 
         template<typename T, typename... Args>
         void emplace(T&& v, Args&&... args) {
-            auto h = m_op.store<std::remove_cv_t<T>>();
+            if (!*this) return;
+            auto h = m_op.template store<std::remove_cv_t<T>>();
             h->emplace(key(), std::forward<T>(v));
 
             if constexpr (sizeof...(Args) > 0) {
@@ -246,23 +1037,26 @@ namespace abc {
 
         template<typename T, typename... Us, typename E>
         void merge(const E& e) {
-            if (auto v = e.view<T>()) {
-                m_op.store<T>()->assign(key(), *v);
+            if (auto v = e.template view<T>()) {
+                m_op.template store<T>()->assign(key(), *v);
             }
             if constexpr (sizeof...(Us) > 0) {
                 merge<Us...>(e);
             }
         }
 
+        /// @brief 可写访问:值所在的存储块被快照共享时会先复制,只读时应使用const版本
         template<typename T>
-        std::enable_if_t<!abc::project<T>::value, T*> view() noexcept {
-            if (auto h = m_op.store<T>()) { return h->at(key()); }
+        std::enable_if_t<!abc::project<T>::value, T*> view() {
+            if (!*this) return nullptr;
+            if (auto h = m_op.template store<T>()) { return h->at(key()); }
             return nullptr;
         }
 
         template<typename T>
         std::enable_if_t<!abc::project<T>::value, const T*> view() const noexcept {
-            if (auto h = m_op.store<T>()) { return h->at(key()); }
+            if (!*this) return nullptr;
+            if (auto h = m_op.template store<T>()) { return std::as_const(*h).at(key()); }
             return nullptr;
         }
 
@@ -275,8 +1069,9 @@ namespace abc {
         }
 
         template<typename T>
-        std::enable_if_t<abc::project<T>::value, typename abc::project<T>::type*> view() noexcept {
-            if (auto h = m_op.store<T>()) {
+        std::enable_if_t<abc::project<T>::value, typename abc::project<T>::type*> view() {
+            if (!*this) return nullptr;
+            if (auto h = m_op.template store<T>()) {
                 if (auto vp = h->at(key())) {
                     return std::addressof(abc::project<T>::to(*vp));
                 }
@@ -286,15 +1081,16 @@ namespace abc {
 
         template<typename T>
         std::enable_if_t<abc::project<T>::value, const typename abc::project<T>::type*> view() const noexcept {
-            if (auto h = m_op.store<T>()) {
-                if (auto vp = h->at(key())) {
+            if (!*this) return nullptr;
+            if (auto h = m_op.template store<T>()) {
+                if (auto vp = std::as_const(*h).at(key())) {
                     return std::addressof(abc::project<T>::to(*vp));
                 }
             }
             return nullptr;
         }
 
-        template<typename T,typename U = abc::project<T>::type >
+        template<typename T, typename U = typename abc::project<T>::type>
         std::enable_if_t<abc::project<T>::value, U> value_or(const U& v) const noexcept {
             if (auto vp = view<T>()) {
                 return *vp;
@@ -303,16 +1099,28 @@ namespace abc {
         }
 
         template<typename T, typename... Us>
-        void erase() noexcept {
-            if (auto h = m_op.store<T>()) { h->erase(key()); }
+        void erase() {
+            if (!*this) return;
+            if (auto h = m_op.template store<T>()) { h->erase(key()); }
 
             if constexpr (sizeof...(Us) > 0) {
                 erase<Us...>();
             }
         }
 
+        /// @brief 标记通过值地址直接修改过的值
+        template<typename T, typename... Us>
+        void touch() {
+            if (!*this) return;
+            if (auto h = std::as_const(m_op).template store<T>()) { h->touch(key()); }
+
+            if constexpr (sizeof...(Us) > 0) {
+                touch<Us...>();
+            }
+        }
+
         template<typename Fn, typename... Us>
-        auto apply(Fn&& fn, Us&&... args) noexcept {
+        auto apply(Fn&& fn, Us&&... args) {
             return fn(std::forward<Us>(args)..., view<Ts>()...);
         }
 
@@ -323,7 +1131,7 @@ namespace abc {
 
         /// @brief 将包含的值投射到参数(引用、指针引用形式)上
         template<typename... Args>
-        void project(Args&... args) noexcept {
+        void project(Args&&... args) {
             (im::project_to(*this, args), ...);
         }
 
@@ -336,7 +1144,7 @@ namespace abc {
         }
 
         template<typename T>
-        std::enable_if_t<abc::project<T>::value, void> project(T& v) noexcept {
+        std::enable_if_t<abc::project<T>::value, void> project(T& v) {
             typename abc::project<T>::type src{ *this };
             abc::project<T>::to(src, v);
         }
@@ -404,7 +1212,7 @@ namespace abc {
         /// @tparam T 可迭代类型
         template<typename T>
         struct container {
-            using iterator = iterator<T>;
+            using iterator = im::iterator<T>;
             using revertse_iterator = std::reverse_iterator<iterator>;
 
             container(T&& first, T&& last) :m_first(std::move(first)), m_last(std::move(last)) {};
@@ -427,8 +1235,22 @@ namespace abc {
             std::string_view code;
             std::unique_ptr<indexed_array_base> values;
         };
+        /// @brief 缓存的联合查询结果,参与类型的值数组结构版本变化时重建
+        struct typed_group {
+            std::string_view code;
+            std::vector<std::size_t> versions;
+            std::vector<std::size_t> keys;
+        };
         std::vector<typed_value_array> m_arrays;
-        std::vector<std::size_t>  m_entitys;
+        /// @brief 实体状态表:状态最低位标识实体是否有效,其余位为代数;
+        /// 移除实体时代数递增,键进入空闲列表等待复用
+        struct entity_table {
+            std::vector<std::size_t> states;
+            std::vector<std::size_t> free;
+            std::size_t generation{};//新键的初始代数
+        };
+        std::shared_ptr<entity_table>  m_entitys;
+        std::vector<std::unique_ptr<typed_group>> m_groups;
     private:
         template<typename... Ts>
         friend  class archetype;
@@ -452,8 +1274,41 @@ namespace abc {
             return static_cast<indexed_array<T>*>(m_arrays.back().values.get());
         }
 
+        /// @brief 实体状态在快照间共享,修改时复制
+        const entity_table& entitys() const noexcept {
+            static const entity_table empty{};
+            return m_entitys ? *m_entitys : empty;
+        }
+
+        entity_table& writable_entitys() {
+            if (m_entitys == nullptr) {
+                m_entitys = std::make_shared<entity_table>();
+            }
+            else if (m_entitys.use_count() > 1) {
+                m_entitys = std::make_shared<entity_table>(*m_entitys);
+            }
+            return *m_entitys;
+        }
+
+        template<typename... Ts>
+        void detach(entity_view<Ts...>*) {
+            auto detach_array = [](indexed_array_base* vp) {
+                if (vp != nullptr) {
+                    vp->detach();
+                }
+            };
+            (detach_array(value_array_of<Ts>()), ...);
+        }
+
+        /// @brief 并行遍历期间不允许增删实体,先于任何修改检查
+        void ensure_unfrozen() const {
+            for (auto&& o : m_arrays) {
+                o.values->ensure_unfrozen();
+            }
+        }
+
         bool next_valid(std::size_t& index) const noexcept {
-            auto n = m_entitys.size();
+            auto n = size();
             if (index == invalid_key) {
                 index = 0;
                 if (contains(index)) {
@@ -477,8 +1332,7 @@ namespace abc {
             return true;
         }
 
-        static constexpr std::size_t  empty_value = 0;
-        static constexpr std::size_t  no_empty_value = 1;
+        static constexpr std::size_t  alive_bit = 1;
     public:
         static constexpr std::size_t  invalid_key = std::numeric_limits<std::size_t>::max();
 
@@ -496,6 +1350,7 @@ namespace abc {
         repository& operator=(const repository& other) {
             if (std::addressof(other) != this) {
                 m_entitys = other.m_entitys;
+                m_groups.clear();
                 m_arrays.clear();
                 m_arrays.reserve(other.m_arrays.size());
                 for (auto& o : other.m_arrays) {
@@ -505,55 +1360,116 @@ namespace abc {
             return *this;
         }
 
+        /// @brief 创建快照:实体状态及值数组均按块共享,复杂度与块数量成正比
+        /// 之后任何一方首次修改某块时才复制该块,内存增长只与修改过的块相关;
+        /// 快照后本存储库应重新获取值地址,之前获取的地址可能仍指向共享块
+        repository snapshot() const {
+            repository result{};
+            result.m_entitys = m_entitys;
+            result.m_arrays.reserve(m_arrays.size());
+            for (auto& o : m_arrays) {
+                result.m_arrays.emplace_back(typed_value_array{ o.code,o.values->share() });
+            }
+            return result;
+        }
+
         repository(repository&& other) noexcept
-            :m_arrays(std::move(other.m_arrays)), m_entitys(std::move(other.m_entitys))
+            :m_arrays(std::move(other.m_arrays)), m_entitys(std::move(other.m_entitys)), m_groups(std::move(other.m_groups))
         {};
 
         repository& operator=(repository&& other) noexcept {
             if (std::addressof(other) != this) {
                 m_arrays = std::move(other.m_arrays);
                 m_entitys = std::move(other.m_entitys);
+                m_groups = std::move(other.m_groups);
             }
             return *this;
         }
 
         bool contains(std::size_t key) const noexcept {
-            if (key >= m_entitys.size()) return false;
-            return m_entitys[key] != empty_value;
+            if (m_entitys == nullptr || key >= m_entitys->states.size()) return false;
+            return (m_entitys->states[key] & alive_bit) != 0;
+        }
+
+        /// @brief 键当前的代数,键不存在时返回invalid_key
+        std::size_t generation(std::size_t key) const noexcept {
+            auto&& states = entitys().states;
+            if (key >= states.size()) return invalid_key;
+            return states[key] >> 1;
         }
 
-        std::size_t  size() const noexcept { return m_entitys.size(); }
+        std::size_t  size() const noexcept { return entitys().states.size(); }
 
         bool   empty() const noexcept {
-            return std::all_of(m_entitys.begin(), m_entitys.end(), [](auto v) { return v == empty_value; });
+            auto&& states = entitys().states;
+            return std::none_of(states.begin(), states.end(), [](auto v) { return (v & alive_bit) != 0; });
         }
 
         void   resize(std::size_t n) {
-            auto number = m_entitys.size();
+            auto number = size();
             if (n > number) {
-                m_entitys.resize(n, no_empty_value);
+                auto&& table = writable_entitys();
+                table.states.resize(n, (table.generation << 1) | alive_bit);
             }
             else {
                 for (std::size_t i = n; i < number; i++) {
                     erase(i);
                 }
-                m_entitys.resize(n);
+                //与shrink一致:被截掉键上的代数并入新键的初始代数,指向它们的失效视图仍能被识别
+                auto&& table = writable_entitys();
+                for (std::size_t i = n; i < number; i++) {
+                    table.generation = std::max(table.generation, table.states[i] >> 1);
+                }
+                table.states.resize(n);
+                table.free.erase(std::remove_if(table.free.begin(), table.free.end(), [n](auto key) { return key >= n; }), table.free.end());
             }
         }
 
+        /// @brief 创建实体,优先复用已移除实体的键
         entity_view<> emplace_back() {
-            m_entitys.emplace_back(no_empty_value);
-            return entity_view<>{*this, m_entitys.size() - 1};
+            ensure_unfrozen();
+            auto&& table = writable_entitys();
+            if (!table.free.empty()) {
+                auto key = table.free.back();
+                table.free.pop_back();
+                table.states[key] |= alive_bit;
+                return entity_view<>{*this, key};
+            }
+            table.states.emplace_back((table.generation << 1) | alive_bit);
+            return entity_view<>{*this, table.states.size() - 1};
         }
 
-        void erase(std::size_t key) noexcept {
+        void erase(std::size_t key) {
             if (!contains(key)) return;
-            m_entitys[key] = empty_value;
+            ensure_unfrozen();
+            auto&& table = writable_entitys();
+            //清除有效位并递增代数
+            table.states[key] += 1;
+            table.free.emplace_back(key);
             for (auto&& o : m_arrays) {
                 o.values->erase(key);
             }
         }
 
+        /// @brief 收缩:截掉末尾已移除的实体并整理各值数组,释放空闲内存
+        /// 被截掉键上的代数并入新键的初始代数,指向它们的失效视图仍能被识别;之后需重新获取值地址
+        void shrink() {
+            auto&& table = writable_entitys();
+            auto n = table.states.size();
+            while (n > 0 && (table.states[n - 1] & alive_bit) == 0) {
+                table.generation = std::max(table.generation, table.states[n - 1] >> 1);
+                n--;
+            }
+            table.states.resize(n);
+            table.states.shrink_to_fit();
+            table.free.erase(std::remove_if(table.free.begin(), table.free.end(), [n](auto key) { return key >= n; }), table.free.end());
+            table.free.shrink_to_fit();
+
+            for (auto&& o : m_arrays) {
+                o.values->shrink();
+            }
+        }
+
         entity_view<> at(std::size_t key) noexcept { return entity_view<>{*this, key}; }
         entity_view<> operator[](std::size_t key) noexcept { return entity_view<>{*this, key}; };
 
@@ -561,7 +1477,7 @@ namespace abc {
         /// @tparam ...Ts 实体视图包含的类型列表
         template<typename... Ts>
         struct iterable_view_object {
-            using value_type = typename entity_view<Ts...>;
+            using value_type = entity_view<Ts...>;
             value_type  object;
 
             explicit iterable_view_object(repository* repo, std::size_t key) :object(*repo, key) {};
@@ -570,7 +1486,7 @@ namespace abc {
             auto value_pointer() noexcept { return std::addressof(object); }
 
             bool operator==(const iterable_view_object& rhs) const noexcept { return object == rhs.object; }
-            bool operator!=(const iterable_view_object& rhs) const noexcept { !(*this == rhs); }
+            bool operator!=(const iterable_view_object& rhs) const noexcept { return !(*this == rhs); }
 
             void forward() noexcept {
                 auto key = object.key();
@@ -593,10 +1509,179 @@ namespace abc {
             iterable_view_object<Ts...> first{ this, invalid_key };
             first.forward();
             iterable_view_object<Ts...> last = first;
-            last.object.bind(m_entitys.size());
+            last.object.bind(size());
             return im::container<iterable_view_object<Ts...>>{std::move(first), std::move(last)};
         };
 
+        /// @brief 联合遍历的可迭代类型:以值数量最少的值数组驱动,其余值数组只做存在性检查
+        /// @tparam ...Ts 实体必须包含的值类型列表
+        template<typename... Ts>
+        struct iterable_join_object {
+            using value_type = entity_view<Ts...>;
+            using seek_fn = void(*)(iterable_join_object&, bool) noexcept;
+
+            value_type  object;
+            void*       array{};
+            seek_fn     seek{};
+            std::size_t slot{};
+
+            explicit iterable_join_object(repository* repo) :object(*repo, invalid_key) {};
+
+            value_type& value_reference() noexcept { return object; }
+            auto value_pointer() noexcept { return std::addressof(object); }
+
+            bool operator==(const iterable_join_object& rhs) const noexcept { return (array == rhs.array) && (slot == rhs.slot); }
+            bool operator!=(const iterable_join_object& rhs) const noexcept { return !(*this == rhs); }
+
+            /// @brief 从当前槽位开始查找满足条件的实体,向前找不到时停在结束位置
+            template<typename U>
+            static void seek_impl(iterable_join_object& o, bool forward) noexcept {
+                auto vp = static_cast<indexed_array<U>*>(o.array);
+                auto match = [&](std::size_t slot) {
+                    if constexpr (!indexed_array<U>::dense) {
+                        if (!vp->contains(slot)) return false;
+                    }
+                    o.object.bind(vp->key_at(slot));
+                    return o.object.template contains<Ts...>();
+                };
+
+                const auto n = vp->slots();
+                auto slot = o.slot;
+                if (forward) {
+                    while (slot < n && !match(slot)) {
+                        slot++;
+                    }
+                }
+                else {
+                    //槽位0同样需要匹配并绑定实体;前方没有匹配项时停在末尾
+                    while (!match(slot)) {
+                        if (slot == 0) {
+                            slot = n;
+                            break;
+                        }
+                        slot--;
+                    }
+                }
+                o.slot = slot;
+            }
+
+            void forward() noexcept {
+                if (!seek) return;
+                slot++;
+                seek(*this, true);
+            }
+
+            void backward() noexcept {
+                if (!seek || slot == 0) return;
+                slot--;
+                seek(*this, false);
+            }
+        };
+
+        /// @brief 联合遍历同时包含多种值类型的实体,开销与最小值数组的规模成正比
+        /// @tparam ...Ts 实体必须包含的值类型列表
+        /// @return 虚拟的实体视图容器(遍历顺序为驱动值数组的存储顺序)
+        template<typename... Ts>
+        auto join() noexcept {
+            static_assert(sizeof...(Ts) > 0, "join requires at least one value type");
+            using object_type = iterable_join_object<Ts...>;
+            object_type first{ this };
+            std::size_t least = invalid_key;
+            std::size_t n = 0;
+            bool missing = false;
+            auto choose = [&](auto* vp, typename object_type::seek_fn seek) {
+                if (vp == nullptr) {
+                    missing = true;
+                }
+                else if (vp->count() < least) {
+                    least = vp->count();
+                    n = vp->slots();
+                    first.array = vp;
+                    first.seek = seek;
+                }
+            };
+            (choose(value_array_of<Ts>(), &object_type::template seek_impl<Ts>), ...);
+            if (missing) {
+                first.array = nullptr;
+                first.seek = nullptr;
+                n = 0;
+            }
+
+            object_type last = first;
+            last.slot = n;
+            if (first.seek) {
+                first.seek(first, true);
+            }
+            return im::container<object_type>{std::move(first), std::move(last)};
+        }
+
+        /// @brief 针对缓存联合结果的可迭代类型
+        template<typename... Ts>
+        struct iterable_group_object {
+            using value_type = entity_view<Ts...>;
+
+            value_type  object;
+            const std::vector<std::size_t>* keys{};
+            std::size_t pos{};
+
+            explicit iterable_group_object(repository* repo, const std::vector<std::size_t>* keys_arg, std::size_t i)
+                :object(*repo, invalid_key), keys(keys_arg), pos(i) {
+                bind();
+            };
+
+            value_type& value_reference() noexcept { return object; }
+            auto value_pointer() noexcept { return std::addressof(object); }
+
+            bool operator==(const iterable_group_object& rhs) const noexcept { return (keys == rhs.keys) && (pos == rhs.pos); }
+            bool operator!=(const iterable_group_object& rhs) const noexcept { return !(*this == rhs); }
+
+            void bind() noexcept {
+                if (pos < keys->size()) {
+                    object.bind((*keys)[pos]);
+                }
+            }
+
+            void forward() noexcept { pos++; bind(); }
+            void backward() noexcept { pos--; bind(); }
+        };
+
+        /// @brief 缓存的联合遍历,适用于热点查询:结果在参与类型的值增删前一直有效,无需重复探测
+        /// @tparam ...Ts 实体必须包含的值类型列表
+        /// @return 虚拟的实体视图容器
+        template<typename... Ts>
+        auto group() {
+            static_assert(sizeof...(Ts) > 0, "group requires at least one value type");
+            auto version_of = [](const indexed_array_base* vp) {
+                return vp != nullptr ? vp->version() : invalid_key;
+            };
+            std::vector<std::size_t> versions{ version_of(value_array_of<Ts>())... };
+
+            typed_group* target = nullptr;
+            for (auto&& o : m_groups) {
+                if (o->code == type_code_of<Ts...>()) {
+                    target = o.get();
+                    break;
+                }
+            }
+            if (target == nullptr) {
+                m_groups.emplace_back(std::make_unique<typed_group>(typed_group{ type_code_of<Ts...>(), {}, {} }));
+                target = m_groups.back().get();
+                target->versions.assign(sizeof...(Ts), invalid_key - 1);
+            }
+            if (target->versions != versions) {
+                target->keys.clear();
+                for (auto&& e : join<Ts...>()) {
+                    target->keys.emplace_back(e.key());
+                }
+                target->versions = std::move(versions);
+            }
+
+            using object_type = iterable_group_object<Ts...>;
+            object_type first{ this, &target->keys, 0 };
+            object_type last{ this, &target->keys, target->keys.size() };
+            return im::container<object_type>{std::move(first), std::move(last)};
+        }
+
         auto begin() noexcept { return views<>().begin(); }
         auto end() noexcept { return views<>().end(); }
         auto rbegin() noexcept { return views<>().rbegin(); }
@@ -618,7 +1703,7 @@ namespace abc {
             auto value_pointer() noexcept { return std::addressof(logic_object); }
 
             bool operator==(const iterable_project_view_object& rhs) const noexcept { return entity == rhs.entity; }
-            bool operator!=(const iterable_project_view_object& rhs) const noexcept { !(*this == rhs); }
+            bool operator!=(const iterable_project_view_object& rhs) const noexcept { return !(*this == rhs); }
 
             void update() noexcept {
                 logic_object = T{};
@@ -679,12 +1764,14 @@ namespace abc {
         /// @tparam T 逻辑类型
         /// @return 虚拟的逻辑类型容器
         template<typename T>
-        auto project_views() noexcept {
+        auto project_views() {
+            //投射可能获取可写的值地址,事先复制共享的存储块,遍历过程中不再复制
+            detach(static_cast<typename project<T>::type*>(nullptr));
             iterable_project_view_object<T> first{ this,invalid_key };
             first.forward();
 
             iterable_project_view_object<T> last = first;
-            last.entity.bind(m_entitys.size());
+            last.entity.bind(size());
             return im::container<iterable_project_view_object<T>>{std::move(first), std::move(last)};
         }
 
@@ -702,72 +1789,251 @@ namespace abc {
             T& value() noexcept { return *m_value; };
         };
 
+        /// @brief 值数组的可迭代类型,T为const时只读遍历
         template<typename T>
         struct iterable_value_object
         {
-            using value_type = typename item<T>;
-            indexed_array<T>* array;
+            using value_type = item<T>;
+            using array_type = std::conditional_t<std::is_const_v<T>, const indexed_array<std::remove_const_t<T>>, indexed_array<T>>;
+            array_type*  array;
+            std::size_t  slot;
             item<T>      value;
 
-            explicit iterable_value_object(indexed_array<T>* array_arg, std::size_t i)
-                :array(array_arg), value(i, nullptr) {
-                if (array && value.key() < array->size()) {
-                    value = item<T>{ value.key(),(*array)[value.key()] };
+            explicit iterable_value_object(array_type* array_arg, std::size_t i)
+                :array(array_arg), slot(i) {
+                if (array && slot < array->slots()) {
+                    if constexpr (array_type::dense) {
+                        value = item<T>{ array->key_at(slot),array->value_at(slot) };
+                    }
+                    else if (array->value_at(slot) == nullptr) {
+                        forward();
+                    }
+                    else {
+                        value = item<T>{ slot,array->value_at(slot) };
+                    }
                 }
             };
 
             value_type& value_reference() noexcept { return value; }
             auto value_pointer() noexcept { return std::addressof(value); }
 
-            bool operator==(const iterable_value_object& rhs) const noexcept { return (array == rhs.array) && (value.key() == rhs.value.key()); }
-            bool operator!=(const iterable_value_object& rhs) const noexcept { !(*this == rhs); }
+            bool operator==(const iterable_value_object& rhs) const noexcept { return (array == rhs.array) && (slot == rhs.slot); }
+            bool operator!=(const iterable_value_object& rhs) const noexcept { return !(*this == rhs); }
 
             void forward() noexcept {
                 if (!array) return;
-                auto n = array->size();
-                for (auto i = value.key() + 1; i < n; i++) {
-                    if ((*array)[i] != nullptr) {
-                        value = item<T>{ i,(*array)[i] };
-                        return;
+                auto n = array->slots();
+                if constexpr (array_type::dense) {
+                    //稀疏集存储的槽位均有效,无需判空
+                    if (++slot < n) {
+                        value = item<T>{ array->key_at(slot),array->value_at(slot) };
+                    }
+                    return;
+                }
+                else {
+                    for (slot = slot + 1; slot < n; slot++) {
+                        if (auto vp = array->value_at(slot)) {
+                            value = item<T>{ slot,vp };
+                            return;
+                        }
                     }
+                    value = item<T>{ n,nullptr };
                 }
-                value = item<T>{ n,nullptr };
             }
 
             void backward() noexcept {
-                if (!array || value.key() == 0) return;
-                auto i = value.key();
-                while (i > 0) {
-                    i--;
-                    if ((*array)[i] != nullptr) {
-                        value = item<T>{ i,(*array)[i] };
+                if (!array) return;
+                while (slot > 0) {
+                    slot--;
+                    if (auto vp = array->value_at(slot)) {
+                        value = item<T>{ array->key_at(slot),vp };
                         return;
                     }
                 }
-                value = item<T>{ i,(*array)[i] };
             }
         };
 
         /// @brief 遍历指定的值类型数组
+        /// 可写遍历前先复制快照间共享的存储块,遍历过程中不再复制;只读遍历应使用const版本
         /// @tparam T 值类型
         /// @return 虚拟的值数组容器(value_array<T>)
         template<typename T>
-        auto values() noexcept {
+        auto values() {
             auto array = value_array_of<T>();
+            if (array != nullptr) {
+                array->detach();
+            }
             iterable_value_object<T> first{ array,0 };
-            iterable_value_object<T> last{ array,array != nullptr ? array->size() : 0 };
+            iterable_value_object<T> last{ array,array != nullptr ? array->slots() : 0 };
             return im::container<iterable_value_object<T>>{std::move(first), std::move(last)};
         }
 
+        /// @brief 只读遍历指定的值类型数组,不会复制共享的存储块
+        template<typename T>
+        auto values() const noexcept {
+            const indexed_array<T>* array = value_array_of<T>();
+            iterable_value_object<const T> first{ array,0 };
+            iterable_value_object<const T> last{ array,array != nullptr ? array->slots() : 0 };
+            return im::container<iterable_value_object<const T>>{std::move(first), std::move(last)};
+        }
+
+        /// @brief 并行遍历同时包含Ts...的实体,对每个实体调用一次fn(key, Ts&...)
+        /// 以值数量最少的值数组驱动,按块对齐的槽位范围划分任务,在工作窃取线程池上执行;
+        /// fn可修改值,但遍历期间不得增删实体及所遍历类型的值(抛出std::logic_error),
+        /// 也不得在fn中再次以同一线程池调用parallel_for_each(抛出std::logic_error)
+        template<typename... Ts, typename Fn>
+        void parallel_for_each(work_stealing_pool& pool, Fn&& fn) {
+            static_assert(sizeof...(Ts) > 0, "parallel_for_each requires at least one value type");
+            //先于冻结检查,避免嵌套调用解除外层的冻结
+            if (pool.running()) {
+                throw std::logic_error("parallel_for_each cannot be nested on the same pool");
+            }
+            std::tuple<indexed_array<Ts>*...> arrays{ value_array_of<Ts>()... };
+            if (!(std::get<indexed_array<Ts>*>(arrays) && ...)) return;
+
+            //共享的存储块需事先复制,避免多个线程同时复制同一块
+            std::size_t least = invalid_key;
+            std::size_t driver = 0;
+            std::size_t i = 0;
+            auto prepare = [&](indexed_array_base* vp, std::size_t count) {
+                vp->detach();
+                vp->freeze(true);
+                if (count < least) {
+                    least = count;
+                    driver = i;
+                }
+                i++;
+            };
+            (prepare(std::get<indexed_array<Ts>*>(arrays), std::get<indexed_array<Ts>*>(arrays)->count()), ...);
+
+            struct unfreeze {
+                std::tuple<indexed_array<Ts>*...>& arrays;
+                ~unfreeze() { (std::get<indexed_array<Ts>*>(arrays)->freeze(false), ...); }
+            } guard{ arrays };
+
+            i = 0;
+            auto launch = [&](auto* vp) {
+                if (i++ != driver) return;
+                using array_type = std::remove_pointer_t<decltype(vp)>;
+                const auto slots = vp->slots();
+                const auto blocks = (slots + array_type::block_size - 1) / array_type::block_size;
+                pool.run(blocks, [&](std::size_t block) {
+                    auto first = block * array_type::block_size;
+                    auto last = std::min(slots, first + array_type::block_size);
+                    for (auto slot = first; slot < last; slot++) {
+                        if constexpr (!array_type::dense) {
+                            if (!vp->contains(slot)) continue;
+                        }
+                        auto key = vp->key_at(slot);
+                        auto value_of = [&](auto* array) {
+                            //驱动值数组直接按槽位取值
+                            if constexpr (std::is_same_v<decltype(array), array_type*>) {
+                                return array->value_at(slot);
+                            }
+                            else {
+                                return array->at(key);
+                            }
+                        };
+                        std::tuple<Ts*...> values{ value_of(std::get<indexed_array<Ts>*>(arrays))... };
+                        if ((std::get<Ts*>(values) && ...)) {
+                            fn(key, *std::get<Ts*>(values)...);
+                        }
+                    }
+                    });
+            };
+            (launch(std::get<indexed_array<Ts>*>(arrays)), ...);
+        }
+
+        template<typename... Ts, typename Fn>
+        void parallel_for_each(Fn&& fn) {
+            parallel_for_each<Ts...>(work_stealing_pool::shared(), std::forward<Fn>(fn));
+        }
+
         /// @brief 根据提供的数据组件值查找对应实体(只负责找到第一个)
+        /// 值类型启用了value_index时借助索引查找,否则线性遍历
         template<typename T>
         entity_view<> find(const T& v) {
-            for (auto&& o : values<std::remove_cv_t<T>>()) {
-                if (o.value() == v) {
-                    return entity_view<>{*this, o.key()};
+            using U = std::remove_cv_t<T>;
+            if constexpr (value_index<U>::value) {
+                auto array = value_array_of<U>();
+                auto key = array != nullptr ? array->index().find(v) : invalid_key;
+                return entity_view<>{*this, key};
+            }
+            else {
+                for (auto&& o : std::as_const(*this).template values<U>()) {
+                    if (o.value() == v) {
+                        return entity_view<>{*this, o.key()};
+                    }
                 }
+                return entity_view<>{*this, invalid_key};
+            }
+        }
+
+        /// @brief 查找值等于v的所有实体键
+        template<typename T>
+        std::vector<std::size_t> find_all(const T& v) const {
+            using U = std::remove_cv_t<T>;
+            std::vector<std::size_t> result;
+            if constexpr (value_index<U>::value) {
+                if (auto array = value_array_of<U>()) {
+                    array->index().for_each(v, [&](std::size_t key) { result.emplace_back(key); });
+                }
+            }
+            else {
+                for (auto&& o : values<U>()) {
+                    if (o.value() == v) {
+                        result.emplace_back(o.key());
+                    }
+                }
+            }
+            return result;
+        }
+
+        /// @brief 通过值地址直接修改已索引的值后,重建该值类型的二级索引
+        template<typename T>
+        void reindex() {
+            static_assert(value_index<T>::value, "value type is not indexed");
+            if (auto array = value_array_of<T>()) {
+                array->reindex();
+            }
+        }
+
+        /// @brief 值类型当前的变更版本
+        template<typename T>
+        std::size_t change_version() const noexcept {
+            static_assert(change_tracking<T>::value, "value type is not tracked");
+            auto array = value_array_of<T>();
+            return array != nullptr ? array->changes().version() : 0;
+        }
+
+        /// @brief 查询自since版本以来的净变更,复杂度与期间的变更记录数成正比
+        /// 使用方保存返回的version作为下次查询的起点,即可只处理两次查询之间的增量
+        template<typename T>
+        change_set changes(std::size_t since) const {
+            static_assert(change_tracking<T>::value, "value type is not tracked");
+            if (auto array = value_array_of<T>()) {
+                return std::as_const(*array).changes().collect(since);
+            }
+            change_set result{};
+            result.complete = (since == 0);
+            return result;
+        }
+
+        /// @brief 丢弃版本不大于v的变更记录,应取所有使用方已处理到的最小版本
+        template<typename T>
+        void trim_changes(std::size_t v) {
+            static_assert(change_tracking<T>::value, "value type is not tracked");
+            if (auto array = value_array_of<T>()) {
+                array->changes().trim(v);
+            }
+        }
+
+        /// @brief 标记通过值地址直接修改过的值,并行遍历期间不可调用
+        template<typename T>
+        void touch(std::size_t key) {
+            if (auto array = value_array_of<T>()) {
+                array->touch(key);
             }
-            return entity_view<>{*this, invalid_key};
         }
     };
 
@@ -807,10 +2073,30 @@ namespace abc {
         }
     }
 
+    template<typename ...Ts>
+    inline entity_view<Ts...>::entity_view(archetype<Ts...> op, std::size_t key)
+        :m_op(std::move(op)), m_key(key)
+    {
+        bind(key);
+    }
+
+    template<typename ...Ts>
+    inline entity_view<Ts...>::entity_view(repository& repo, std::size_t key)
+        :m_op(repo), m_key(key), m_generation(repo.generation(key)) {};
+
+    template<typename ...Ts>
+    inline void entity_view<Ts...>::bind(std::size_t key) noexcept
+    {
+        m_key = key;
+        auto repo = m_op.container();
+        m_generation = (repo != nullptr) ? repo->generation(key) : repository::invalid_key;
+    }
+
     template<typename ...Ts>
     inline entity_view<Ts...>::operator bool() const noexcept
     {
-        return (m_op.container() != nullptr) && (m_op.container()->contains(m_key));
+        auto repo = m_op.container();
+        return (repo != nullptr) && repo->contains(m_key) && (repo->generation(m_key) == m_generation);
     }
 
     namespace examples
@@ -890,7 +2176,7 @@ namespace abc {
     /// 3. 定义从type到业务类型的转换(这里没有限制,也可以让业务类型附带实体)
     template<>
     struct project<examples::TestObject> : std::true_type {
-        using type = typename entity_view<int, double>;
+        using type = entity_view<int, double>;
 
         static void to(type& src, examples::TestObject& dst) {
             double* dV{};
@@ -2,6 +2,7 @@
 
 #include "RepoImpl.hpp"
 #include <string>
+#include <typeinfo>
 
 namespace abc
 {
@@ -106,8 +107,6 @@ namespace abc
         };
 
         class Repository final {
-            static constexpr char  Empty = '0';
-            static constexpr char  Valid = '1';
         public:
             Repository() = default;
             Repository(const Repository & other);
@@ -116,34 +115,38 @@ namespace abc
             Repository& operator=(Repository && other) noexcept;
 
             bool contains(std::size_t key) const noexcept {
-                if (key >= m_entitys.size()) return false;
-                return m_entitys[key] != Empty;
+                return m_entitys.test(key);
             }
 
             std::size_t size() const noexcept {
                 return m_entitys.size();
             }
 
+            /// @brief 有效实体数量
+            std::size_t count() const noexcept {
+                return m_entitys.count();
+            }
+
             bool empty() const noexcept {
-                return (m_entitys.find_first_not_of(Empty) != m_entitys.npos);
+                return m_entitys.none();
             }
 
             void resize(std::size_t n) {
                 auto number = m_entitys.size();
                 if (n > number) {
-                    m_entitys.resize(n, Valid);
+                    m_entitys.resize(n, true);
                 }
                 else {
                     for (std::size_t i = n; i < number; i++) {
                         erase(i);
                     }
-                    m_entitys.resize(n);
+                    m_entitys.resize(n, false);
                 }
             }
 
             void erase(std::size_t key) noexcept {
                 if (!contains(key)) return;
-                m_entitys[key] = Empty;
+                m_entitys.reset(key);
                 for (auto& o : m_components) {
                     if (o) {
                         o->erase(key);
@@ -153,7 +156,7 @@ namespace abc
 
             template<typename... Args>
             EntityView emplace_back(Args&&... args) {
-                m_entitys.push_back(Valid);
+                m_entitys.push_back(true);
                 auto result = EntityView{ *this,int(m_entitys.size() - 1) };
                 if constexpr (sizeof...(Args) > 0) {
                     result.emplace(std::forward<Args>(args)...);
@@ -184,14 +187,51 @@ namespace abc
                 return im::ValueArrayProxy<T>{ComponentOf<T>()};
             }
 
+            /// @brief 根据值查找对应实体(只负责找到一个),值类型启用了ValueIndex时借助索引查找
             template<typename T>
             EntityView find(const T& v) {
-                for (auto&& o : values<std::remove_cv_t<T>>()) {
-                    if (o.value() == v) {
-                        return EntityView{ *this,o.key() };
+                using U = std::remove_cv_t<T>;
+                if constexpr (ValueIndex<U>::value) {
+                    auto array = std::as_const(*this).ComponentOf<U>();
+                    return EntityView{ *this,array != nullptr ? array->index().find(v) : -1 };
+                }
+                else {
+                    for (auto&& o : values<U>()) {
+                        if (o.value() == v) {
+                            return EntityView{ *this,o.key() };
+                        }
+                    }
+                    return EntityView{ *this,-1 };
+                }
+            }
+
+            /// @brief 查找值等于v的所有实体键
+            template<typename T>
+            std::vector<int> find_all(const T& v) {
+                using U = std::remove_cv_t<T>;
+                std::vector<int> result;
+                if constexpr (ValueIndex<U>::value) {
+                    if (auto array = std::as_const(*this).ComponentOf<U>()) {
+                        array->index().for_each(v, [&](int key) { result.emplace_back(key); });
+                    }
+                }
+                else {
+                    for (auto&& o : values<U>()) {
+                        if (o.value() == v) {
+                            result.emplace_back(o.key());
+                        }
                     }
                 }
-                return EntityView{ *this,-1 };
+                return result;
+            }
+
+            /// @brief 通过值地址直接修改已索引的值后,重建该值类型的二级索引
+            template<typename T>
+            void reindex() {
+                static_assert(ValueIndex<T>::value, "value type is not indexed");
+                if (auto array = std::as_const(*this).ComponentOf<T>()) {
+                    array->reindex();
+                }
             }
         private:
             template<typename T>
@@ -218,19 +258,11 @@ namespace abc
                 return result;
             }
 
+            /// @brief 跳到下一个有效实体,空白区域按字整体跳过
             bool next_valid(int& index) const noexcept {
                 auto n = m_entitys.size();
-                if (index == -1) {
-                    index = 0;
-                    if (contains(index)) {
-                        return true;
-                    }
-                }
-
-                if (index >= n) return false;
-                do {
-                    index++;
-                } while (index < n && !contains(index));
+                if (index >= 0 && std::size_t(index) >= n) return false;
+                index = int(m_entitys.find_next(std::size_t(index + 1)));
                 return true;
             }
         private:
@@ -238,7 +270,7 @@ namespace abc
         private:
             friend class EntityView;
             std::vector<std::unique_ptr<im::IValueArray>> m_components;
-            std::string      m_entitys;
+            im::Bitset       m_entitys;
         };
 
         template<typename T>
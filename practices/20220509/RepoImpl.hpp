@@ -2,6 +2,19 @@
 #include <vector>
 #include <memory>
 #include <iterator>
+#include <algorithm>
+#include <utility>
+#include <limits>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 namespace abc
 {
@@ -9,6 +22,207 @@ namespace abc
     {
         namespace im
         {
+            /// @brief 值到实体键的多值映射,哈希索引与有序索引只有底层容器不同
+            template<typename Map>
+            class MultiIndex {
+            public:
+                using ValueType = typename Map::key_type;
+                static constexpr int npos = -1;
+
+                void insert(const ValueType& v, int key) { m_keys.emplace(v, key); }
+
+                void erase(const ValueType& v, int key) noexcept {
+                    auto [first, last] = m_keys.equal_range(v);
+                    for (; first != last; ++first) {
+                        if (first->second == key) {
+                            m_keys.erase(first);
+                            return;
+                        }
+                    }
+                }
+
+                void clear() noexcept { m_keys.clear(); }
+
+                /// @brief 查找值对应的实体键,不存在时返回npos
+                int find(const ValueType& v) const {
+                    auto it = m_keys.find(v);
+                    return it != m_keys.end() ? it->second : npos;
+                }
+
+                template<typename Fn>
+                void for_each(const ValueType& v, Fn&& fn) const {
+                    auto [first, last] = m_keys.equal_range(v);
+                    for (; first != last; ++first) {
+                        fn(first->second);
+                    }
+                }
+            private:
+                Map m_keys;
+            };
+        }
+
+        /// @brief 哈希索引:值到实体键的多值映射,查找为O(1),find返回任意一个实体键
+        template<typename T, typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>>
+        class HashIndex :public im::MultiIndex<std::unordered_multimap<T, int, Hash, KeyEqual>> {};
+
+        /// @brief 有序索引:值到实体键的多值映射,查找为O(log n),相等值按加入顺序排列,find返回第一个实体键
+        template<typename T, typename Compare = std::less<T>>
+        class SortedIndex :public im::MultiIndex<std::multimap<T, int, Compare>> {};
+
+        /// @brief 值索引策略:特化为std::true_type并以type指定HashIndex或SortedIndex,即可为该值类型维护二级索引
+        /// 索引随emplace/erase维护;通过值地址直接修改已索引的值后,需调用Repository::reindex<T>()
+        template<typename T, typename E = void>
+        struct ValueIndex : std::false_type {};
+
+        namespace im
+        {
+            /// @brief 紧凑位集合:按64位字扫描,支持AVX2时一次跳过256位的空白区域
+            class Bitset {
+                using Word = std::uint64_t;
+                static constexpr std::size_t Bits = 64;
+            public:
+                std::size_t size() const noexcept { return m_size; }
+
+                bool test(std::size_t i) const noexcept {
+                    if (i >= m_size) return false;
+                    return ((m_words[i / Bits] >> (i % Bits)) & 1) != 0;
+                }
+
+                void set(std::size_t i) noexcept { m_words[i / Bits] |= (Word{ 1 } << (i % Bits)); }
+                void reset(std::size_t i) noexcept { m_words[i / Bits] &= ~(Word{ 1 } << (i % Bits)); }
+
+                void push_back(bool value) {
+                    if (m_size % Bits == 0) {
+                        m_words.push_back(0);
+                    }
+                    if (value) {
+                        set(m_size);
+                    }
+                    m_size++;
+                }
+
+                /// @brief 调整大小,新增位设置为value
+                void resize(std::size_t n, bool value) {
+                    if (n < m_size) {
+                        m_words.resize((n + Bits - 1) / Bits);
+                        m_size = n;
+                        clear_tail();
+                        return;
+                    }
+                    if (value) {
+                        //先将当前末尾字中的空闲位置位
+                        if (m_size % Bits != 0) {
+                            m_words.back() |= ~Word{} << (m_size % Bits);
+                        }
+                        m_words.resize((n + Bits - 1) / Bits, ~Word{});
+                    }
+                    else {
+                        m_words.resize((n + Bits - 1) / Bits, Word{});
+                    }
+                    m_size = n;
+                    clear_tail();
+                }
+
+                /// @brief 置位数量
+                std::size_t count() const noexcept {
+                    std::size_t result = 0;
+                    for (auto w : m_words) {
+                        result += popcount(w);
+                    }
+                    return result;
+                }
+
+                bool none() const noexcept {
+                    return find_word(0) == m_words.size();
+                }
+
+                /// @brief 从pos(含)开始查找下一个置位,找不到时返回size()
+                std::size_t find_next(std::size_t pos) const noexcept {
+                    if (pos >= m_size) return m_size;
+                    auto i = pos / Bits;
+                    auto w = m_words[i] & (~Word{} << (pos % Bits));
+                    if (w == 0) {
+                        i = find_word(i + 1);
+                        if (i == m_words.size()) return m_size;
+                        w = m_words[i];
+                    }
+                    return i * Bits + ctz(w);
+                }
+            private:
+                /// @brief 从第i个字开始查找非零字
+                std::size_t find_word(std::size_t i) const noexcept {
+                    const auto n = m_words.size();
+#if defined(__AVX2__)
+                    for (; i + 4 <= n; i += 4) {
+                        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_words.data() + i));
+                        if (!_mm256_testz_si256(v, v)) break;
+                    }
+#endif
+                    for (; i < n; i++) {
+                        if (m_words[i] != 0) return i;
+                    }
+                    return n;
+                }
+
+                /// @brief 保证超出大小的位始终为0
+                void clear_tail() noexcept {
+                    if (m_size % Bits != 0) {
+                        m_words.back() &= ~(~Word{} << (m_size % Bits));
+                    }
+                }
+
+                static std::size_t popcount(Word w) noexcept {
+#if defined(_MSC_VER) && defined(_M_X64)
+                    return static_cast<std::size_t>(__popcnt64(w));
+#elif defined(__GNUC__) || defined(__clang__)
+                    return static_cast<std::size_t>(__builtin_popcountll(w));
+#else
+                    std::size_t result = 0;
+                    for (; w != 0; w &= w - 1) {
+                        result++;
+                    }
+                    return result;
+#endif
+                }
+
+                static std::size_t ctz(Word w) noexcept {
+#if defined(_MSC_VER) && defined(_M_X64)
+                    unsigned long result{};
+                    _BitScanForward64(&result, w);
+                    return result;
+#elif defined(__GNUC__) || defined(__clang__)
+                    return static_cast<std::size_t>(__builtin_ctzll(w));
+#else
+                    std::size_t result = 0;
+                    for (; (w & 1) == 0; w >>= 1) {
+                        result++;
+                    }
+                    return result;
+#endif
+                }
+            private:
+                std::vector<Word> m_words;
+                std::size_t       m_size{};
+            };
+
+            /// @brief 值数组持有的二级索引,未启用时不做任何维护
+            template<typename T, bool Enable = ValueIndex<T>::value>
+            struct IndexHolder {
+                void insert(const T&, int) noexcept {}
+                void erase(const T&, int) noexcept {}
+                void clear() noexcept {}
+            };
+
+            template<typename T>
+            struct IndexHolder<T, true> {
+                typename ValueIndex<T>::type index;
+
+                const auto& get() const noexcept { return index; }
+                void insert(const T& v, int key) { index.insert(v, key); }
+                void erase(const T& v, int key) noexcept { index.erase(v, key); }
+                void clear() noexcept { index.clear(); }
+            };
+
             class IValueArray {
             public:
                 virtual ~IValueArray() = default;
@@ -51,8 +265,10 @@ namespace abc
                         pointer = alloc(std::forward<Args>(args)...);
                     }
                     else {
+                        m_index.erase(*pointer, int(index));
                         *pointer = T{ std::forward<Args>(args)... };
                     }
+                    m_index.insert(*pointer, int(index));
                 }
 
                 std::add_pointer_t<T> at(std::size_t i) {
@@ -66,6 +282,7 @@ namespace abc
                     if (index < m_pointers.size()) {
                         auto&& pointer = m_pointers[index];
                         if (pointer != nullptr) {
+                            m_index.erase(*pointer, int(index));
                             std::exchange(*pointer, T{});
                             pointer = nullptr;
                         }
@@ -92,8 +309,22 @@ namespace abc
                             result->m_pointers[i] = std::addressof(dst->back());
                         }
                     }
+                    result->m_index = m_index;
                     return result;
                 }
+
+                /// @brief 二级索引,仅在ValueIndex<T>启用时可用
+                decltype(auto) index() const noexcept { return m_index.get(); }
+
+                /// @brief 依据当前值重建二级索引
+                void reindex() {
+                    m_index.clear();
+                    for (std::size_t i = 0; i < m_pointers.size(); i++) {
+                        if (m_pointers[i] != nullptr) {
+                            m_index.insert(*m_pointers[i], int(i));
+                        }
+                    }
+                }
             protected:
                 template<typename... Args>
                 std::add_pointer_t<T> alloc(Args&&... args) {
@@ -113,12 +344,12 @@ namespace abc
             private:
                 std::vector<std::unique_ptr<std::vector<T>>> m_blocks;
                 std::vector<std::add_pointer_t<T>> m_pointers;
+                IndexHolder<T> m_index;
             };
 
             template<typename T>
             class ValueArrayProxy final {
             public:
-                template<typename T>
                 class Item {
                     int m_key{ -1 };
                     T* m_value{};
@@ -131,11 +362,10 @@ namespace abc
                     T& value() noexcept { return *m_value; };
                 };
 
-                template<typename T>
                 struct Iterable
                 {
                     using difference_type = std::ptrdiff_t;
-                    using value_type = Item<T>;
+                    using value_type = Item;
                     using pointer = value_type*;
                     using reference = value_type&;
                     using iterator_category = std::forward_iterator_tag;
@@ -143,7 +373,7 @@ namespace abc
                     explicit Iterable(ValueArray<T>* array_arg, int i)
                         :array(array_arg), value(i, nullptr) {
                         if (array && value.key() < array->size()) {
-                            value = Item<T>{ value.key(),(*array)[value.key()] };
+                            value = Item{ value.key(),(*array)[value.key()] };
                         }
                     };
 
@@ -181,15 +411,15 @@ namespace abc
                         auto n = array->size();
                         for (auto i = value.key() + 1; i < n; i++) {
                             if ((*array)[i] != nullptr) {
-                                value = Item<T>{ int(i),(*array)[i] };
+                                value = Item{ int(i),(*array)[i] };
                                 return;
                             }
                         }
-                        value = Item<T>{ int(n),nullptr };
+                        value = Item{ int(n),nullptr };
                     }
                 private:
                     ValueArray<T>* array;
-                    Item<T>        value;
+                    Item        value;
                 };
             public:
                 explicit ValueArrayProxy(ValueArray<T>* array)
@@ -4,6 +4,12 @@
 
 using namespace abc;
 
+/// @brief 字符串值建立哈希索引,find/find_all不再线性遍历
+template<>
+struct abc::ValueIndex<std::string> :std::true_type {
+    using type = abc::HashIndex<std::string>;
+};
+
 
 struct RuntimeEntity {
     EntityView e;
@@ -64,6 +70,9 @@ void RepoTest() {
     auto it = std::any_of(strings.begin(), strings.end(), [](const auto& v) {  return v.value() == std::string{ "liff.cpplang@gmail.com" }; });
 
     auto e = repo.find(std::string{ "liff.cpplang@gmail.com" });
+    for (auto key : repo.find_all(std::string{ "liff.engineer@gmail.com" })) {
+        std::cout << "find_all:" << key << "\n";
+    }
     std::vector<std::string> ss{};
     for (auto&& e : repo) {
         if (!e.contains<std::string>())
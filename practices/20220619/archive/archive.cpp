@@ -31,3 +31,69 @@ void IArchive::Unregister(const char* format) {
 
 Archive::Archive(const char* format)
     :m_impl(Create(format)) {}
+
+bool IArReader::try_read_array(ArElement e, IArrayBuffer& v) const
+{
+    auto n = size();
+    std::size_t i = 0;
+    bool result = false;
+    ArVisit(e, [&](auto tag) {
+        using T = decltype(tag);
+        auto p = static_cast<T*>(v.resize(n));
+        result = read([&](const IArReader& o) {
+            if (i == n) return;
+            if constexpr (std::is_floating_point_v<T>) {
+                double rv{};
+                o.read(rv);
+                p[i] = static_cast<T>(rv);
+            }
+            else if constexpr (std::is_signed_v<T>) {
+                int64_t rv{};
+                o.read(rv);
+                p[i] = static_cast<T>(rv);
+            }
+            else {
+                uint64_t rv{};
+                o.read(rv);
+                p[i] = static_cast<T>(rv);
+            }
+            i++;
+            });
+        });
+    v.resize(i);
+    return result;
+}
+
+void IArchive::try_write(const char* m, IWriter& writer)
+{
+    if (begin_scope(m)) {
+        writer.write(*this);
+        end_scope();
+        return;
+    }
+    if (gArchiveBuilders == nullptr) return;
+    auto it = gArchiveBuilders->find(format());
+    if (it == gArchiveBuilders->end()) return;
+    auto ar = it->second();
+    writer.write(*ar);
+    try_write(m, *ar);
+}
+
+void IArchive::try_write_array(ArElement e, const void* data, std::size_t n)
+{
+    ArVisit(e, [&](auto tag) {
+        using T = decltype(tag);
+        auto p = static_cast<const T*>(data);
+        for (std::size_t i = 0; i < n; i++) {
+            if constexpr (std::is_floating_point_v<T>) {
+                write(nullptr, static_cast<double>(p[i]));
+            }
+            else if constexpr (std::is_signed_v<T>) {
+                write(nullptr, static_cast<int64_t>(p[i]));
+            }
+            else {
+                write(nullptr, static_cast<uint64_t>(p[i]));
+            }
+        }
+        });
+}
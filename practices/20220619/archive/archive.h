@@ -17,6 +17,9 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
 
 template<typename T, typename E = void>
 struct ArAdapter :std::false_type {
@@ -31,6 +34,58 @@ struct ArAdapter :std::false_type {
     }
 };
 
+//数组批量读写支持的连续数值类型
+enum class ArElement :std::uint8_t {
+    Int8,
+    Int16,
+    Int32,
+    Int64,
+    UInt8,
+    UInt16,
+    UInt32,
+    UInt64,
+    Float,
+    Double,
+};
+
+template<typename T, typename E = void>
+struct ArElementOf :std::false_type {};
+
+template<typename T>
+struct ArElementOf<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> && sizeof(T) <= 8>> :std::true_type {
+    static constexpr ArElement kind = std::is_signed_v<T>
+        ? (sizeof(T) == 1 ? ArElement::Int8 : sizeof(T) == 2 ? ArElement::Int16 : sizeof(T) == 4 ? ArElement::Int32 : ArElement::Int64)
+        : (sizeof(T) == 1 ? ArElement::UInt8 : sizeof(T) == 2 ? ArElement::UInt16 : sizeof(T) == 4 ? ArElement::UInt32 : ArElement::UInt64);
+};
+
+template<>
+struct ArElementOf<float> :std::true_type {
+    static constexpr ArElement kind = ArElement::Float;
+};
+
+template<>
+struct ArElementOf<double> :std::true_type {
+    static constexpr ArElement kind = ArElement::Double;
+};
+
+/// @brief 以数值类型e对应的值调用fn
+template<typename Fn>
+void ArVisit(ArElement e, Fn&& fn) {
+    switch (e) {
+    case ArElement::Int8:   fn(std::int8_t{}); break;
+    case ArElement::Int16:  fn(std::int16_t{}); break;
+    case ArElement::Int32:  fn(std::int32_t{}); break;
+    case ArElement::Int64:  fn(std::int64_t{}); break;
+    case ArElement::UInt8:  fn(std::uint8_t{}); break;
+    case ArElement::UInt16: fn(std::uint16_t{}); break;
+    case ArElement::UInt32: fn(std::uint32_t{}); break;
+    case ArElement::UInt64: fn(std::uint64_t{}); break;
+    case ArElement::Float:  fn(float{}); break;
+    case ArElement::Double: fn(double{}); break;
+    default: break;
+    }
+}
+
 class IArReader {
 public:
     virtual ~IArReader() = default;
@@ -65,12 +120,14 @@ public:
 
     template<typename Fn>
     std::enable_if_t<std::is_invocable_v<Fn, const IArReader&>, bool> read(Fn&& fn) const {
-        return try_read_impl(nullptr, Type::Array, ArrayReader<Fn>{std::forward<Fn>(fn)});
+        ArrayReader<Fn> reader{ std::forward<Fn>(fn) };
+        return try_read_impl(nullptr, Type::Array, reader);
     }
 
     template<typename Fn>
     std::enable_if_t<std::is_invocable_v<Fn, const char*, const IArReader&>, bool> read(Fn&& fn) const {
-        return try_read_impl(nullptr, Type::Object, ObjectReader<Fn>{std::forward<Fn>(fn)});
+        ObjectReader<Fn> reader{ std::forward<Fn>(fn) };
+        return try_read_impl(nullptr, Type::Object, reader);
     }
 
     template<typename T>
@@ -79,7 +136,8 @@ public:
             return ArAdapter<T>::read(*this, m, v);
         }
         else {
-            return try_read_impl(m, Type::Internal, Reader<T>{v});
+            Reader<T> reader{ v };
+            return try_read_impl(m, Type::Internal, reader);
         }
     }
 
@@ -87,6 +145,13 @@ public:
     bool  read_as(T& v) const {
         return ArAdapter<T>::read(*this, v);
     }
+
+    //数值数组批量读取,元素追加到v
+    template<typename... Ts>
+    bool  read_array(std::vector<Ts...>& v) const {
+        ArrayBuffer<std::vector<Ts...>> buffer{ v };
+        return try_read_array(ArElementOf<typename std::vector<Ts...>::value_type>::kind, buffer);
+    }
 protected:
     enum class Type {
         Boolean,  //布尔量
@@ -133,8 +198,26 @@ protected:
             return true;
         }
     };
+    struct IArrayBuffer {
+        //调整为n个新元素,返回首个新元素地址
+        virtual void* resize(std::size_t n) = 0;
+    };
+
+    template<typename V>
+    struct ArrayBuffer final :public IArrayBuffer {
+        V* obj;
+        std::size_t offset;
+        explicit ArrayBuffer(V& o) :obj(std::addressof(o)), offset(o.size()) {};
+        void* resize(std::size_t n) override {
+            obj->resize(offset + n);
+            return obj->data() + offset;
+        }
+    };
+
     virtual bool try_read_impl(const char* m, Type type, void* v) const = 0;
     virtual bool try_read_impl(const char* m, Type type, IReader& v) const = 0;
+    //默认逐个元素读取,存档实现可一次性填充
+    virtual bool try_read_array(ArElement e, IArrayBuffer& v) const;
 };
 
 class Archive;
@@ -160,6 +243,14 @@ public:
     virtual bool open(const std::string& file) = 0;
     virtual bool save(const std::string& file) const = 0;
 
+    //流式读取:逐个读取文件根数组(m为空)或根对象成员m对应数组中的元素,
+    //支持的存档实现无需持有完整文档,其它实现则先open再读取
+    template<typename Fn>
+    std::enable_if_t<std::is_invocable_v<Fn, const IArReader&>, bool> stream(const std::string& file, const char* m, Fn&& fn) {
+        ArrayReader<Fn> reader{ std::forward<Fn>(fn) };
+        return try_stream_impl(file, m, reader);
+    }
+
     //调试支持(非必须,仅针对文本格式的存档)
     virtual std::string to_string() const = 0;
 
@@ -204,7 +295,8 @@ public:
         }
         else
         {
-            try_write(m, Writer<T>{v});
+            Writer<T> writer{ v };
+            try_write(m, writer);
         }
     }
 
@@ -221,6 +313,12 @@ public:
         ArAdapter<T>::write(*this, v);
     }
 
+    //数值数组批量写入当前数组
+    template<typename T>
+    void write_array(const T* data, std::size_t n) {
+        try_write_array(ArElementOf<T>::kind, data, n);
+    }
+
     bool write_tag(const char* tag) {
         if (std::strcmp(format(), "xml") == 0) {
             return write_tag_impl(tag);
@@ -241,10 +339,26 @@ protected:
         }
     };
 
-    virtual void try_write(const char* m, IWriter& writer) = 0;
+    //嵌套对象/数组直接写入当前存档:begin_scope进入成员m(为空则追加数组元素),end_scope返回上一层;
+    //默认不支持,此时嵌套值先写入同格式的临时存档,再经try_write(m, IArchive&)写入
+    virtual bool begin_scope(const char*) { return false; }
+    virtual void end_scope() {}
+
+    virtual void try_write(const char* m, IWriter& writer);
     virtual bool try_write(const char* m, IArchive& v) = 0;
     virtual void try_write_impl(const char* m, Type type, const void* v) = 0;
+    //默认逐个元素写入,存档实现可一次性写入
+    virtual void try_write_array(ArElement e, const void* data, std::size_t n);
     virtual bool write_tag_impl(const char* tag) { return false; };
+    virtual bool try_stream_impl(const std::string& file, const char* m, IReader& v) {
+        if (!open(file)) return false;
+        if (!m) return try_read_impl(nullptr, Type::Array, v);
+        auto forward = [&](const IArReader& ar) {
+            ar.read([&](const IArReader& o) { v.read(nullptr, o); });
+        };
+        ArrayReader<decltype(forward)> reader{ std::move(forward) };
+        return try_read_impl(m, Type::Internal, reader);
+    }
 };
 
 class Archive final {
@@ -334,19 +448,30 @@ struct ArAdapter<T, std::enable_if_t<std::is_unsigned_v<T>>> :std::true_type
 
 template<typename... Ts>
 struct ArAdapter<std::vector<Ts...>> :std::false_type {
+    using value_type = typename std::vector<Ts...>::value_type;
 
     static void write(IArchive& ar, const std::vector<Ts...>& v) {
-        for (auto& o : v) {
-            ar.write(o);
+        if constexpr (ArElementOf<value_type>::value) {
+            ar.write_array(v.data(), v.size());
+        }
+        else {
+            for (auto& o : v) {
+                ar.write(o);
+            }
         }
     }
 
     static bool read(const IArReader& ar, std::vector<Ts...>& v) {
-        v.reserve(v.size() + ar.size());
-        ar.read([&](const IArReader& o) {
-            v.resize(v.size() + 1);
-            o.read(v.back());
-            });
+        if constexpr (ArElementOf<value_type>::value) {
+            ar.read_array(v);
+        }
+        else {
+            v.reserve(v.size() + ar.size());
+            ar.read([&](const IArReader& o) {
+                v.resize(v.size() + 1);
+                o.read(v.back());
+                });
+        }
         return true;
     }
 };
@@ -0,0 +1,127 @@
+﻿#include "mapped_file.h"
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_opened, other.m_opened);
+#if defined(_WIN32)
+        std::swap(m_file, other.m_file);
+        std::swap(m_mapping, other.m_mapping);
+#endif
+    }
+    return *this;
+}
+
+#if defined(_WIN32)
+bool MappedFile::open(const std::string& file, Mode mode)
+{
+    close();
+    HANDLE h = ::CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    m_file = h;
+
+    LARGE_INTEGER len{};
+    if (!::GetFileSizeEx(h, &len)) {
+        close();
+        return false;
+    }
+    m_opened = true;
+    m_size = static_cast<std::size_t>(len.QuadPart);
+    if (m_size == 0) return true;
+
+    //写时复制映射同样以只读方式创建,视图使用FILE_MAP_COPY
+    m_mapping = ::CreateFileMappingA(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping) {
+        auto access = (mode == Mode::CopyOnWrite) ? FILE_MAP_COPY : FILE_MAP_READ;
+        m_data = static_cast<char*>(::MapViewOfFile(m_mapping, access, 0, 0, 0));
+    }
+    if (!m_data) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() noexcept
+{
+    if (m_data) {
+        ::UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        ::CloseHandle(m_mapping);
+    }
+    if (m_file) {
+        ::CloseHandle(m_file);
+    }
+    m_data = nullptr;
+    m_mapping = nullptr;
+    m_file = nullptr;
+    m_size = 0;
+    m_opened = false;
+}
+#else
+bool MappedFile::open(const std::string& file, Mode mode)
+{
+    close();
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+    if (m_size != 0) {
+        auto prot = (mode == Mode::CopyOnWrite) ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        auto p = ::mmap(nullptr, m_size, prot, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            m_size = 0;
+            return false;
+        }
+        m_data = static_cast<char*>(p);
+        //存档解析为顺序读取
+        ::madvise(p, m_size, MADV_SEQUENTIAL);
+    }
+    //映射建立后即可关闭文件描述符
+    ::close(fd);
+    m_opened = true;
+    return true;
+}
+
+void MappedFile::close() noexcept
+{
+    if (m_data) {
+        ::munmap(m_data, m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_opened = false;
+}
+#endif
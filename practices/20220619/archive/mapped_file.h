@@ -0,0 +1,44 @@
+﻿//文件内存映射,供存档实现在打开文件时直接解析映射区域,避免读入额外缓冲区
+#pragma once
+#include <cstddef>
+#include <string>
+
+class MappedFile final {
+public:
+    enum class Mode {
+        ReadOnly,    //只读映射
+        CopyOnWrite, //可写的私有映射,修改不会写回文件(供原地解析使用)
+    };
+
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /// @brief 映射文件,空文件映射成功但data()为空
+    bool open(const std::string& file, Mode mode = Mode::ReadOnly);
+    void close() noexcept;
+
+    explicit operator bool() const noexcept {
+        return m_opened;
+    }
+
+    char* data() noexcept { return m_data; }
+    const char* data() const noexcept { return m_data; }
+    std::size_t size() const noexcept { return m_size; }
+
+    const char* begin() const noexcept { return m_data; }
+    const char* end() const noexcept { return m_data + m_size; }
+private:
+    char* m_data{};
+    std::size_t m_size{};
+    bool m_opened{};
+#if defined(_WIN32)
+    void* m_file{};
+    void* m_mapping{};
+#endif
+};
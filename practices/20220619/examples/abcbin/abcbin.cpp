@@ -0,0 +1,760 @@
+﻿//abcbin:直接写入的带标签二进制存档,读取时在缓冲区上原地解析,不构造DOM
+//值布局(按本机字节序):
+//- 标签(1字节)
+//- 布尔/空值: 无负载
+//- 整数: zigzag变长编码;无符号整数: 变长编码(LEB128);数值: 8字节
+//- 字符串: 长度(变长编码) + 内容 + '\0',读取时键可原地使用
+//- 数组/对象: 负载字节数(uint32) + 成员数(uint32) + 成员;对象成员为 键(同字符串) + 值
+//- 数值数组: 元素类型(ArElement,1字节) + 元素数(变长编码) + 连续存储的元素
+//文件为 魔数 + 根值,根值始终是数组/对象头,未写入成员时标签为空值
+//打开文件时整体校验一次,之后的原地解析信任其中的长度、变长编码与成员数
+#include "archive.h"
+#include "mapped_file.h"
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace
+{
+    static const auto binary_archive_format = "abcbin";
+    static const char binary_archive_magic[4] = { 'A','B','C','B' };
+
+    enum class Tag :std::uint8_t {
+        Nil,
+        False,
+        True,
+        Integer,
+        UInteger,
+        Number,
+        String,
+        Array,
+        Object,
+        TypedArray,
+    };
+
+    //数组/对象头:标签 + 负载字节数 + 成员数
+    constexpr std::size_t container_header_size = 1 + sizeof(std::uint32_t) * 2;
+
+    template<typename T>
+    T load(const char* p) {
+        T result;
+        std::memcpy(&result, p, sizeof(T));
+        return result;
+    }
+
+    inline Tag tag_of(const char* p) {
+        return static_cast<Tag>(*p);
+    }
+
+    inline std::uint64_t load_varint(const char*& p) {
+        std::uint64_t result = 0;
+        for (int shift = 0;; shift += 7) {
+            auto byte = static_cast<std::uint8_t>(*p++);
+            result |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return result;
+        }
+    }
+
+    inline std::int64_t load_zigzag(const char* p) {
+        auto v = load_varint(p);
+        return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+    }
+
+    inline std::uint64_t load_unsigned(const char* p) {
+        return load_varint(p);
+    }
+
+    /// @brief 读取字符串,p移动到其后位置
+    inline const char* load_string(const char*& p, std::size_t* n = nullptr) {
+        auto len = static_cast<std::size_t>(load_varint(p));
+        auto result = p;
+        p += len + 1;
+        if (n) *n = len;
+        return result;
+    }
+
+    /// @brief 跳过字符串,返回其后位置
+    inline const char* skip_string(const char* p) {
+        load_string(p);
+        return p;
+    }
+
+    inline std::size_t element_size(ArElement e) {
+        std::size_t result{};
+        ArVisit(e, [&](auto tag) { result = sizeof(tag); });
+        return result;
+    }
+
+    /// @brief 数值数组的元素类型、元素数与数据位置
+    struct TypedArray {
+        ArElement e;
+        std::size_t n;
+        const char* data;
+
+        explicit TypedArray(const char* p)
+            :e(static_cast<ArElement>(p[1])) {
+            p += 2;
+            n = static_cast<std::size_t>(load_varint(p));
+            data = p;
+        }
+
+        const char* end() const noexcept {
+            return data + n * element_size(e);
+        }
+
+        /// @brief 将第i个元素编码为带标签的值,供逐个元素读取使用
+        const char* encode(std::size_t i, char* out) const {
+            ArVisit(e, [&](auto tag) {
+                using T = decltype(tag);
+                auto v = load<T>(data + i * sizeof(T));
+                auto it = out + 1;
+                std::uint64_t uv{};
+                if constexpr (std::is_floating_point_v<T>) {
+                    out[0] = static_cast<char>(Tag::Number);
+                    double dv = v;
+                    std::memcpy(it, &dv, sizeof(dv));
+                    return;
+                }
+                else if constexpr (std::is_signed_v<T>) {
+                    out[0] = static_cast<char>(Tag::Integer);
+                    auto iv = static_cast<std::int64_t>(v);
+                    uv = (static_cast<std::uint64_t>(iv) << 1) ^ static_cast<std::uint64_t>(iv >> 63);
+                }
+                else {
+                    out[0] = static_cast<char>(Tag::UInteger);
+                    uv = v;
+                }
+                while (uv >= 0x80) {
+                    *it++ = static_cast<char>((uv & 0x7F) | 0x80);
+                    uv >>= 7;
+                }
+                *it = static_cast<char>(uv);
+                });
+            return out;
+        }
+    };
+
+    //编码单个数值所需的最大字节数
+    constexpr std::size_t max_scalar_size = 1 + 10;
+
+    /// @brief 跳过值,返回其后位置
+    inline const char* skip_value(const char* p) {
+        switch (tag_of(p)) {
+        case Tag::Integer:
+        case Tag::UInteger:
+            p++;
+            while (*p & 0x80) p++;
+            return p + 1;
+        case Tag::Number:
+            return p + 1 + sizeof(double);
+        case Tag::String:
+            return skip_string(p + 1);
+        case Tag::Array:
+        case Tag::Object:
+            return p + container_header_size + load<std::uint32_t>(p + 1);
+        case Tag::TypedArray:
+            return TypedArray{ p }.end();
+        default:
+            return p + 1;
+        }
+    }
+
+    //嵌套层数上限:校验递归进行,避免损坏的数据耗尽栈空间
+    constexpr int max_depth = 512;
+
+    /// @brief 校验变长编码完整位于[p,end)内,返回其后位置,损坏时返回nullptr
+    inline const char* check_varint(const char* p, const char* end, std::uint64_t* v = nullptr) {
+        std::uint64_t result = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7) {
+            auto byte = static_cast<std::uint8_t>(*p++);
+            result |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                if (v) *v = result;
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    /// @brief 校验字符串:内容及结尾的'\0'均位于[p,end)内
+    inline const char* check_string(const char* p, const char* end) {
+        std::uint64_t len{};
+        p = check_varint(p, end, &len);
+        if (!p || len >= static_cast<std::uint64_t>(end - p) || p[len] != '\0') return nullptr;
+        return p + len + 1;
+    }
+
+    const char* check_value(const char* p, const char* end, int depth);
+
+    /// @brief 校验数组/对象:负载位于[p,end)内,且成员恰好占满负载
+    inline const char* check_container(const char* p, const char* end, int depth) {
+        if (depth > max_depth || end - p < static_cast<std::ptrdiff_t>(container_header_size)) return nullptr;
+        auto bytes = load<std::uint32_t>(p + 1);
+        auto n = load<std::uint32_t>(p + 1 + sizeof(std::uint32_t));
+        auto it = p + container_header_size;
+        if (bytes > static_cast<std::size_t>(end - it)) return nullptr;
+        auto last = it + bytes;
+        auto isObject = tag_of(p) == Tag::Object;
+        //每个成员至少占一个字节,成员数与负载不符时很快失败
+        for (std::uint32_t i = 0; i < n && it; i++) {
+            if (isObject) {
+                it = check_string(it, last);
+            }
+            if (it) {
+                it = check_value(it, last, depth + 1);
+            }
+        }
+        return it == last ? last : nullptr;
+    }
+
+    /// @brief 校验值完整位于[p,end)内,返回其后位置,损坏时返回nullptr
+    const char* check_value(const char* p, const char* end, int depth) {
+        if (p >= end) return nullptr;
+        switch (tag_of(p)) {
+        case Tag::Nil:
+        case Tag::False:
+        case Tag::True:
+            return p + 1;
+        case Tag::Integer:
+        case Tag::UInteger:
+            return check_varint(p + 1, end);
+        case Tag::Number:
+            return (end - p > static_cast<std::ptrdiff_t>(sizeof(double))) ? p + 1 + sizeof(double) : nullptr;
+        case Tag::String:
+            return check_string(p + 1, end);
+        case Tag::Array:
+        case Tag::Object:
+            return check_container(p, end, depth);
+        case Tag::TypedArray:
+        {
+            if (end - p < 2) return nullptr;
+            auto size = element_size(static_cast<ArElement>(p[1]));
+            std::uint64_t n{};
+            auto data = check_varint(p + 2, end, &n);
+            if (size == 0 || !data || n > static_cast<std::uint64_t>(end - data) / size) return nullptr;
+            return data + n * size;
+        }
+        default:
+            return nullptr;
+        }
+    }
+}
+
+class AbcbinArReader :public IArReader
+{
+public:
+    const char* p;//值起始位置
+
+    struct Impl {
+        const char* p;
+        const char* find(const char* m) const;
+        bool try_read(const char* m, Type type, void* v) const;
+        bool try_read(const char* m, Type type, IReader& v) const;
+        bool try_read_array(ArElement e, IArrayBuffer& v) const;
+    };
+public:
+    explicit AbcbinArReader(const char* pos)
+        :p(pos) {};
+
+    std::size_t size() const noexcept override {
+        switch (tag_of(p)) {
+        case Tag::Nil:
+            return 0;
+        case Tag::Array:
+        case Tag::Object:
+            return load<std::uint32_t>(p + 1 + sizeof(std::uint32_t));
+        case Tag::TypedArray:
+            return TypedArray{ p }.n;
+        default:
+            return 1;
+        }
+    }
+protected:
+    bool try_read_impl(const char* m, Type type, void* v) const override {
+        return Impl{ p }.try_read(m, type, v);
+    }
+
+    bool try_read_impl(const char* m, Type type, IReader& v) const override {
+        return Impl{ p }.try_read(m, type, v);
+    }
+
+    bool try_read_array(ArElement e, IArrayBuffer& v) const override {
+        return Impl{ p }.try_read_array(e, v) || IArReader::try_read_array(e, v);
+    }
+};
+
+class AbcbinArchive :public IArchive
+{
+    //正在写入的数组/对象
+    struct Frame {
+        std::size_t offset;//头部在缓冲区中的位置
+        std::uint32_t count;
+        Tag kind;//未写入成员时为空值
+    };
+
+    std::vector<char>  buffer;
+    std::vector<Frame> frames;
+    //打开的文件映射,读取直接在映射区域上进行,首次写入时才复制到缓冲区
+    std::shared_ptr<const MappedFile> mapping;
+public:
+    AbcbinArchive() {
+        buffer.resize(container_header_size);
+        frames.push_back(Frame{ 0,0,Tag::Nil });
+        patch(frames.back());
+    }
+
+    std::unique_ptr<IArchive> clone() const override {
+        return std::make_unique<AbcbinArchive>(*this);
+    }
+
+    const char* format() const noexcept override {
+        return binary_archive_format;
+    }
+
+    bool open(const std::string& file) override {
+        auto mapped = std::make_shared<MappedFile>();
+        if (!mapped->open(file)) return false;
+        if (mapped->size() < sizeof(binary_archive_magic) + container_header_size) return false;
+        if (std::memcmp(mapped->data(), binary_archive_magic, sizeof(binary_archive_magic)) != 0) return false;
+
+        auto p = mapped->data() + sizeof(binary_archive_magic);
+        auto n = mapped->size() - sizeof(binary_archive_magic);
+        auto kind = tag_of(p);
+        if (kind != Tag::Nil && kind != Tag::Array && kind != Tag::Object) return false;
+        if (kind == Tag::Nil) {
+            if (container_header_size + load<std::uint32_t>(p + 1) != n) return false;
+        }
+        else if (check_container(p, p + n, 0) != p + n) {
+            //嵌套的长度、变长编码、字符串或数值数组越过了文件末尾
+            return false;
+        }
+
+        buffer.clear();
+        frames.clear();
+        frames.push_back(Frame{ 0,load<std::uint32_t>(p + 1 + sizeof(std::uint32_t)),kind });
+        mapping = std::move(mapped);
+        return true;
+    }
+
+    bool save(const std::string& file) const override {
+        std::ofstream ofs(file, std::ios::binary);
+        if (!ofs) return false;
+        ofs.write(binary_archive_magic, sizeof(binary_archive_magic));
+        ofs.write(data(), length());
+        return true;
+    }
+
+    std::string to_string() const override {
+        std::ostringstream oss;
+        dump(oss, data());
+        return oss.str();
+    }
+
+    std::size_t size() const noexcept override {
+        return AbcbinArReader{ data() }.size();
+    }
+protected:
+    bool begin_scope(const char* m) override {
+        if (!prepare(m)) return false;
+        auto offset = buffer.size();
+        buffer.resize(offset + container_header_size);
+        frames.push_back(Frame{ offset,0,Tag::Nil });
+        return true;
+    }
+
+    void end_scope() override {
+        auto frame = frames.back();
+        frames.pop_back();
+        if (frame.kind == Tag::TypedArray) {
+            //数值数组已完整写入
+        }
+        else if (frame.count == 0) {
+            //与Json一致,未写入成员的嵌套值为空值
+            buffer.resize(frame.offset + 1);
+            buffer[frame.offset] = static_cast<char>(Tag::Nil);
+        }
+        else {
+            patch(frame);
+        }
+        commit();
+    }
+
+    bool try_write(const char* m, IArchive& v) override {
+        if (auto vp = dynamic_cast<AbcbinArchive*>(&v)) {
+            if (vp->frames.size() != 1) return false;
+            if (!prepare(m)) return true;
+            if (vp->frames.back().count == 0) {
+                buffer.push_back(static_cast<char>(Tag::Nil));
+            }
+            else {
+                append(vp->data(), vp->length());
+            }
+            commit();
+            return true;
+        }
+        return false;
+    }
+
+    void try_write_impl(const char* m, Type type, const void* v) override {
+        if (!prepare(m)) return;
+        switch (type) {
+        case Type::Boolean:
+            put(*static_cast<const bool*>(v) ? Tag::True : Tag::False);
+            break;
+        case Type::Integer:
+        {
+            auto iv = *static_cast<const int64_t*>(v);
+            put(Tag::Integer);
+            put_varint((static_cast<std::uint64_t>(iv) << 1) ^ static_cast<std::uint64_t>(iv >> 63));
+        }
+        break;
+        case Type::UInteger:
+            put(Tag::UInteger);
+            put_varint(*static_cast<const uint64_t*>(v));
+            break;
+        case Type::Number:
+            put(Tag::Number);
+            append(v, sizeof(double));
+            break;
+        case Type::String:
+            put(Tag::String);
+            put_string(static_cast<const char*>(v));
+            break;
+        default:
+            put(Tag::Nil);
+            break;
+        }
+        commit();
+    }
+
+    void try_write_array(ArElement e, const void* v, std::size_t n) override {
+        auto& frame = frames.back();
+        //只有刚进入的嵌套作用域可整体写为数值数组
+        if (n == 0 || frames.size() == 1 || frame.kind != Tag::Nil) {
+            return IArchive::try_write_array(e, v, n);
+        }
+        frame.kind = Tag::TypedArray;
+        buffer.resize(frame.offset);
+        put(Tag::TypedArray);
+        buffer.push_back(static_cast<char>(e));
+        put_varint(n);
+        append(v, n * element_size(e));
+    }
+
+    bool try_read_impl(const char* m, Type type, void* v) const override {
+        return AbcbinArReader::Impl{ data() }.try_read(m, type, v);
+    }
+
+    bool try_read_impl(const char* m, Type type, IReader& v) const override {
+        return AbcbinArReader::Impl{ data() }.try_read(m, type, v);
+    }
+
+    bool try_read_array(ArElement e, IArrayBuffer& v) const override {
+        return AbcbinArReader::Impl{ data() }.try_read_array(e, v) || IArReader::try_read_array(e, v);
+    }
+private:
+    /// @brief 根值起始位置
+    const char* data() const noexcept {
+        return mapping ? mapping->data() + sizeof(binary_archive_magic) : buffer.data();
+    }
+
+    std::size_t length() const noexcept {
+        return mapping ? mapping->size() - sizeof(binary_archive_magic) : buffer.size();
+    }
+
+    /// @brief 确定当前数组/对象类型并写入键;键与容器类型不符时忽略本次写入
+    bool prepare(const char* m) {
+        if (mapping) {
+            buffer.assign(data(), data() + length());
+            mapping.reset();
+        }
+        auto& frame = frames.back();
+        auto kind = m ? Tag::Object : Tag::Array;
+        if (frame.kind == Tag::Nil) {
+            frame.kind = kind;
+        }
+        else if (frame.kind != kind) {
+            return false;
+        }
+        if (m) {
+            put_string(m);
+        }
+        return true;
+    }
+
+    /// @brief 完成当前数组/对象的一个成员,根值头部随即更新以保证缓冲区可读
+    void commit() {
+        auto& frame = frames.back();
+        frame.count++;
+        if (frames.size() == 1) {
+            patch(frame);
+        }
+    }
+
+    void patch(const Frame& frame) {
+        auto p = buffer.data() + frame.offset;
+        auto bytes = static_cast<std::uint32_t>(buffer.size() - frame.offset - container_header_size);
+        p[0] = static_cast<char>(frame.kind);
+        std::memcpy(p + 1, &bytes, sizeof(bytes));
+        std::memcpy(p + 1 + sizeof(bytes), &frame.count, sizeof(frame.count));
+    }
+
+    void put(Tag tag) {
+        buffer.push_back(static_cast<char>(tag));
+    }
+
+    void append(const void* v, std::size_t n) {
+        auto p = static_cast<const char*>(v);
+        buffer.insert(buffer.end(), p, p + n);
+    }
+
+    void put_varint(std::uint64_t v) {
+        while (v >= 0x80) {
+            buffer.push_back(static_cast<char>((v & 0x7F) | 0x80));
+            v >>= 7;
+        }
+        buffer.push_back(static_cast<char>(v));
+    }
+
+    void put_string(const char* v) {
+        auto n = std::strlen(v);
+        put_varint(n);
+        append(v, n + 1);
+    }
+
+    static void dump(std::ostream& os, const char* p) {
+        switch (tag_of(p)) {
+        case Tag::Nil:
+            os << "null";
+            break;
+        case Tag::False:
+            os << "false";
+            break;
+        case Tag::True:
+            os << "true";
+            break;
+        case Tag::Integer:
+            os << load_zigzag(p + 1);
+            break;
+        case Tag::UInteger:
+            os << load_unsigned(p + 1);
+            break;
+        case Tag::Number:
+            os << load<double>(p + 1);
+            break;
+        case Tag::String:
+        {
+            auto it = p + 1;
+            os << '"' << load_string(it) << '"';
+        }
+        break;
+        case Tag::Array:
+        case Tag::Object:
+        {
+            auto isObject = tag_of(p) == Tag::Object;
+            auto n = load<std::uint32_t>(p + 1 + sizeof(std::uint32_t));
+            auto it = p + container_header_size;
+            os << (isObject ? '{' : '[');
+            for (std::uint32_t i = 0; i < n; i++) {
+                if (i != 0) os << ',';
+                if (isObject) {
+                    os << '"' << load_string(it) << "\":";
+                }
+                dump(os, it);
+                it = skip_value(it);
+            }
+            os << (isObject ? '}' : ']');
+        }
+        break;
+        case Tag::TypedArray:
+        {
+            TypedArray items{ p };
+            char scalar[max_scalar_size];
+            os << '[';
+            for (std::size_t i = 0; i < items.n; i++) {
+                if (i != 0) os << ',';
+                dump(os, items.encode(i, scalar));
+            }
+            os << ']';
+        }
+        break;
+        default:
+            break;
+        }
+    }
+};
+
+namespace
+{
+    struct ArchiveRegister
+    {
+        std::string code;
+
+        ArchiveRegister(const char* format, std::unique_ptr<IArchive>(*ctor)()) :code(format) {
+            IArchive::Register(format, ctor);
+        }
+        ~ArchiveRegister() {
+            IArchive::Unregister(code.c_str());
+        }
+
+        template<typename T>
+        static ArchiveRegister Make(const char* format) {
+            return ArchiveRegister{ format,[]()->std::unique_ptr<IArchive> { return std::make_unique<T>(); } };
+        }
+    };
+    static auto gRegister = ArchiveRegister::Make<AbcbinArchive>(binary_archive_format);
+}
+
+const char* AbcbinArReader::Impl::find(const char* m) const
+{
+    if (tag_of(p) != Tag::Object) return nullptr;
+    auto n = load<std::uint32_t>(p + 1 + sizeof(std::uint32_t));
+    auto it = p + container_header_size;
+    for (std::uint32_t i = 0; i < n; i++) {
+        auto key = load_string(it);
+        if (std::strcmp(key, m) == 0) {
+            return it;
+        }
+        it = skip_value(it);
+    }
+    return nullptr;
+}
+
+bool AbcbinArReader::Impl::try_read(const char* m, Type type, void* v) const
+{
+    auto obj = p;
+    if (m) {
+        obj = find(m);
+        if (!obj) return false;
+    }
+    auto tag = tag_of(obj);
+    switch (type) {
+    case Type::Boolean:
+        if (tag == Tag::True || tag == Tag::False) {
+            *static_cast<bool*>(v) = (tag == Tag::True);
+            return true;
+        }
+        break;
+    case Type::Integer:
+        if (tag == Tag::Integer) {
+            *static_cast<int64_t*>(v) = load_zigzag(obj + 1);
+            return true;
+        }
+        if (tag == Tag::UInteger) {
+            *static_cast<int64_t*>(v) = static_cast<int64_t>(load_unsigned(obj + 1));
+            return true;
+        }
+        break;
+    case Type::UInteger:
+        if (tag == Tag::UInteger) {
+            *static_cast<uint64_t*>(v) = load_unsigned(obj + 1);
+            return true;
+        }
+        if (tag == Tag::Integer && load_zigzag(obj + 1) >= 0) {
+            *static_cast<uint64_t*>(v) = static_cast<uint64_t>(load_zigzag(obj + 1));
+            return true;
+        }
+        break;
+    case Type::Number:
+        if (tag == Tag::Number) {
+            *static_cast<double*>(v) = load<double>(obj + 1);
+            return true;
+        }
+        if (tag == Tag::Integer) {
+            *static_cast<double*>(v) = static_cast<double>(load_zigzag(obj + 1));
+            return true;
+        }
+        if (tag == Tag::UInteger) {
+            *static_cast<double*>(v) = static_cast<double>(load_unsigned(obj + 1));
+            return true;
+        }
+        break;
+    case Type::String:
+        if (tag == Tag::String) {
+            std::size_t n{};
+            auto it = obj + 1;
+            auto str = load_string(it, &n);
+            static_cast<std::string*>(v)->assign(str, n);
+            return true;
+        }
+        break;
+    case Type::Nil:
+        return tag == Tag::Nil;
+    default:
+        break;
+    }
+    return false;
+}
+
+bool AbcbinArReader::Impl::try_read(const char* m, Type type, IReader& v) const
+{
+    auto tag = tag_of(p);
+    switch (type) {
+    case Type::Array:
+        if (tag == Tag::Array) {
+            auto n = load<std::uint32_t>(p + 1 + sizeof(std::uint32_t));
+            auto it = p + container_header_size;
+            for (std::uint32_t i = 0; i < n; i++) {
+                v.read(nullptr, AbcbinArReader{ it });
+                it = skip_value(it);
+            }
+            return true;
+        }
+        if (tag == Tag::TypedArray) {
+            TypedArray items{ p };
+            char scalar[max_scalar_size];
+            for (std::size_t i = 0; i < items.n; i++) {
+                v.read(nullptr, AbcbinArReader{ items.encode(i, scalar) });
+            }
+            return true;
+        }
+        break;
+    case Type::Object:
+        if (tag == Tag::Object) {
+            auto n = load<std::uint32_t>(p + 1 + sizeof(std::uint32_t));
+            auto it = p + container_header_size;
+            for (std::uint32_t i = 0; i < n; i++) {
+                auto key = load_string(it);
+                v.read(key, AbcbinArReader{ it });
+                it = skip_value(it);
+            }
+            return true;
+        }
+        break;
+    case Type::Internal:
+        if (!m) {
+            return v.read(nullptr, AbcbinArReader{ p });
+        }
+        else if (auto obj = find(m); obj) {
+            return v.read(nullptr, AbcbinArReader{ obj });
+        }
+        break;
+    default:
+        break;
+    }
+    return false;
+}
+
+bool AbcbinArReader::Impl::try_read_array(ArElement e, IArrayBuffer& v) const
+{
+    if (tag_of(p) != Tag::TypedArray) return false;
+    TypedArray items{ p };
+    if (items.e == e) {
+        //类型一致时直接复制连续数据
+        if (items.n != 0) {
+            std::memcpy(v.resize(items.n), items.data, items.n * element_size(e));
+        }
+        return true;
+    }
+    ArVisit(e, [&](auto tag) {
+        using T = decltype(tag);
+        auto out = static_cast<T*>(v.resize(items.n));
+        ArVisit(items.e, [&](auto source) {
+            using S = decltype(source);
+            for (std::size_t i = 0; i < items.n; i++) {
+                out[i] = static_cast<T>(load<S>(items.data + i * sizeof(S)));
+            }
+            });
+        });
+    return true;
+}
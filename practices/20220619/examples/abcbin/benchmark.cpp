@@ -0,0 +1,113 @@
+﻿//存档格式对比:写入、保存、打开、读取、流式读取耗时与文件大小
+//用法: abcbinBenchmark [记录数],默认约生成100MB的json文档
+#include "archive.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+struct Record
+{
+    int64_t id;
+    bool flag;
+    double x;
+    double y;
+    double z;
+    std::string name;
+    std::vector<int> tags;
+};
+
+void ArWrite(IArchive* ar, const Record& obj) {
+    ar->write("id", obj.id);
+    ar->write("flag", obj.flag);
+    ar->write("x", obj.x);
+    ar->write("y", obj.y);
+    ar->write("z", obj.z);
+    ar->write("name", obj.name);
+    ar->write("tags", obj.tags);
+}
+
+bool ArRead(const IArReader* ar, Record& obj) {
+    ar->read("id", obj.id);
+    ar->read("flag", obj.flag);
+    ar->read("x", obj.x);
+    ar->read("y", obj.y);
+    ar->read("z", obj.z);
+    ar->read("name", obj.name);
+    ar->read("tags", obj.tags);
+    return true;
+}
+
+namespace
+{
+    template<typename Fn>
+    double measure(Fn&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(stop - start).count();
+    }
+
+    std::size_t file_size(const std::string& file) {
+        std::ifstream ifs(file, std::ios::binary | std::ios::ate);
+        return static_cast<std::size_t>(ifs.tellg());
+    }
+
+    double checksum(const std::vector<Record>& records) {
+        double result = 0.0;
+        for (auto& r : records) {
+            result += r.id + r.x + r.y + r.z + r.name.size() + r.tags.size() + (r.flag ? 1 : 0);
+        }
+        return result;
+    }
+
+    void run(const char* format, const std::vector<Record>& records) {
+        std::string file = std::string{ "benchmark." } + format;
+        double write{}, save{}, open{}, read{}, stream{};
+        {
+            auto ar = Archive(format);
+            write = measure([&]() { ar->write("records", records); });
+            save = measure([&]() { ar->save(file); });
+        }
+        std::vector<Record> result;
+        {
+            auto ar = Archive(format);
+            open = measure([&]() { ar->open(file); });
+            read = measure([&]() { ar->read("records", result); });
+        }
+        std::vector<Record> streamed;
+        stream = measure([&]() {
+            auto ar = Archive(format);
+            ar->stream(file, "records", [&](const IArReader& o) {
+                streamed.emplace_back();
+                o.read(streamed.back());
+                });
+            });
+        auto ok = checksum(result) == checksum(records) && checksum(streamed) == checksum(records);
+        std::printf("%-8s %8.1f MB: write %9.2f ms, save %9.2f ms, open %9.2f ms, read %9.2f ms, stream %9.2f ms, %s\n",
+            format, file_size(file) / (1024.0 * 1024.0), write, save, open, read, stream,
+            ok ? "ok" : "mismatch");
+        std::remove(file.c_str());
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 400000;
+    std::vector<Record> records(n);
+    for (std::size_t i = 0; i < n; i++) {
+        auto& r = records[i];
+        r.id = static_cast<int64_t>(i);
+        r.flag = (i % 3) == 0;
+        r.x = i * 0.5;
+        r.y = i * 0.25;
+        r.z = i * 0.125;
+        r.name = "record_" + std::to_string(i);
+        r.tags = { static_cast<int>(i % 7), static_cast<int>(i % 11), static_cast<int>(i % 13) };
+    }
+
+    for (auto format : { "abcbin", "CBOR", "json" }) {
+        run(format, records);
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+﻿#include "archive.h"
+#include <cstdio>
+
+struct MyObject
+{
+    bool bV;
+    int iV;
+    double dV;
+    std::string sV;
+    std::vector<int> iVs;
+    std::map<int, std::string> kVs;
+};
+
+struct MyComplexObject
+{
+    MyObject oV;
+    std::vector<double> dVs;
+};
+
+void ArWrite(IArchive* ar, const MyObject& obj) {
+    ar->write("bV", obj.bV);
+    ar->write("iV", obj.iV);
+    ar->write("dV", obj.dV);
+    ar->write("sV", obj.sV);
+    ar->write("iVs", obj.iVs);
+    ar->write("kVs", obj.kVs);
+}
+
+bool ArRead(const IArReader* ar, MyObject& obj) {
+    ar->read("bV", obj.bV);
+    ar->read("iV", obj.iV);
+    ar->read("dV", obj.dV);
+    ar->read("sV", obj.sV);
+    ar->read("iVs", obj.iVs);
+    ar->read("kVs", obj.kVs);
+    return true;
+}
+
+void ArWrite(IArchive* ar, const MyComplexObject& obj) {
+    ar->write("oV", obj.oV);
+    ar->write("dVs", obj.dVs);
+}
+
+bool ArRead(const IArReader* ar, MyComplexObject& obj) {
+    ar->read("oV", obj.oV);
+    ar->read("dVs", obj.dVs);
+    return true;
+}
+
+bool test_load_abcbin(std::string const& file, const MyComplexObject& expect) {
+    auto ar = Archive("abcbin");
+    if (!ar->open(file)) return false;
+
+    MyObject obj{};
+    ar->read("MyObject", obj);
+    MyComplexObject obj1{};
+    ar->read("MyComplexObject", obj1);
+
+    return obj.sV == expect.oV.sV && obj.kVs == expect.oV.kVs
+        && obj1.oV.iVs == expect.oV.iVs && obj1.dVs == expect.dVs;
+}
+
+int main() {
+    MyObject obj{};
+    obj.bV = true;
+    obj.iV = 1024;
+    obj.dV = 3.1415926;
+    obj.sV = "liff.engineer@gmail.com";
+    obj.iVs = { 1,3,5,7,9 };
+    obj.kVs = { {1,"liff.xian@gmail.com"},{2,"liff.cpplang@gmail.com"} };
+
+    MyComplexObject obj1{};
+    obj1.oV = obj;
+    obj1.dVs = { 1.1,2.2,3.3,4.4 };
+
+    auto ar = Archive("abcbin");
+    ar->write("MyObject", obj);
+    ar->write("MyComplexObject", obj1);
+    {
+        auto ar1 = Archive("abcbin");
+        ar1->write_as(obj);
+        ar->write("Clone", ar1);
+    }
+    std::printf("%s\n", ar->to_string().c_str());
+    ar->save("result.abcbin");
+    return test_load_abcbin("result.abcbin", obj1) ? 0 : 1;
+}
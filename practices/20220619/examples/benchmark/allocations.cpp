@@ -0,0 +1,194 @@
+﻿//统计各存档写入嵌套模型时每个对象的内存分配次数与耗时
+//- temporary: 不使用begin_scope,每层嵌套值先写入同格式的临时存档再合并(引入嵌套写入之前的方式);
+//  包装存档本身使每个临时存档多一次分配,即每个对象多计1次
+//- direct: 嵌套对象直接写入父存档
+//- nested: 每个对象先写入独立存档,再写入父存档
+//operator new与pugixml的内存分配函数均计入统计
+#include "archive.h"
+#include "pugixml.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace
+{
+    std::atomic<std::size_t> gAllocations{};
+
+    void* pugi_allocate(std::size_t n) {
+        gAllocations.fetch_add(1, std::memory_order_relaxed);
+        return std::malloc(n);
+    }
+
+    void pugi_deallocate(void* p) {
+        std::free(p);
+    }
+}
+
+void* operator new(std::size_t n) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(n ? n : 1)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+struct Leaf
+{
+    int a;
+    double b;
+};
+
+struct Node
+{
+    int64_t id;
+    std::string name;
+    std::vector<Leaf> leafs;
+};
+
+void ArWrite(IArchive* ar, const Leaf& obj) {
+    ar->write("a", obj.a);
+    ar->write("b", obj.b);
+}
+
+void ArWrite(IArchive* ar, const Node& obj) {
+    ar->write("id", obj.id);
+    ar->write("name", obj.name);
+    ar->write("leafs", obj.leafs);
+}
+
+namespace
+{
+    //不提供begin_scope的存档包装:嵌套值经IArchive默认实现写入临时存档后合并
+    class TemporaryArchive final :public IArchive
+    {
+        const char* m_format;
+        Archive m_impl;
+    public:
+        TemporaryArchive(const char* format, const char* impl)
+            :m_format(format), m_impl(impl) {};
+
+        std::unique_ptr<IArchive> clone() const override {
+            return std::make_unique<TemporaryArchive>(*this);
+        }
+        const char* format() const noexcept override {
+            return m_format;
+        }
+        bool open(const std::string& file) override {
+            return m_impl->open(file);
+        }
+        bool save(const std::string& file) const override {
+            return m_impl->save(file);
+        }
+        std::string to_string() const override {
+            return m_impl->to_string();
+        }
+        std::size_t size() const noexcept override {
+            return m_impl->size();
+        }
+    protected:
+        void try_write(const char* m, IWriter& writer) override {
+            //与XmlArchive一致:Xml格式不支持数组
+            if (!m && std::strcmp(m_impl->format(), "xml") == 0) return;
+            IArchive::try_write(m, writer);
+        }
+        bool try_write(const char* m, IArchive& v) override {
+            if (auto vp = dynamic_cast<TemporaryArchive*>(&v)) {
+                m_impl->write(m, vp->m_impl);
+                return true;
+            }
+            return false;
+        }
+        void try_write_impl(const char* m, Type type, const void* v) override {
+            switch (type) {
+            case Type::Boolean: return m_impl->write(m, *static_cast<const bool*>(v));
+            case Type::Integer: return m_impl->write(m, *static_cast<const int64_t*>(v));
+            case Type::UInteger: return m_impl->write(m, *static_cast<const uint64_t*>(v));
+            case Type::Number: return m_impl->write(m, *static_cast<const double*>(v));
+            case Type::String: return m_impl->write(m, static_cast<const char*>(v));
+            default: return m_impl->write(m);
+            }
+        }
+        bool try_read_impl(const char*, Type, void*) const override { return false; }
+        bool try_read_impl(const char*, Type, IReader&) const override { return false; }
+    };
+
+    void write_nodes(Archive& ar, const std::vector<Node>& nodes, const std::vector<std::string>& keys, bool nested) {
+        for (std::size_t i = 0; i < nodes.size(); i++) {
+            auto& node = nodes[i];
+            auto key = keys[i].c_str();
+            if (nested) {
+                auto child = Archive(ar->format());
+                child->write_as(node);
+                ar->write(key, child);
+            }
+            else {
+                ar->write(key, node);
+            }
+        }
+    }
+
+    constexpr std::size_t leaf_count = 8;
+
+    void run(const char* format, const char* temporary, const std::vector<Node>& nodes) {
+        //对象数:节点、叶子以及叶子数组
+        auto objects = nodes.size() * (leaf_count + 2);
+        //每个节点使用不同的键,避免json中同名成员相互覆盖;键事先构造,不计入统计
+        std::vector<std::string> keys;
+        keys.reserve(nodes.size());
+        for (std::size_t i = 0; i < nodes.size(); i++) {
+            keys.push_back("node" + std::to_string(i));
+        }
+        struct Mode {
+            const char* name;
+            const char* format;
+            bool nested;
+        };
+        for (auto mode : { Mode{ "temporary",temporary,false },Mode{ "direct",format,false },Mode{ "nested",format,true } }) {
+            auto ar = Archive(mode.format);
+            auto start = std::chrono::steady_clock::now();
+            auto before = gAllocations.load();
+            write_nodes(ar, nodes, keys, mode.nested);
+            auto count = gAllocations.load() - before;
+            auto stop = std::chrono::steady_clock::now();
+            std::printf("%-6s %-9s: %6.2f allocations/object(%8zu in total), %9.2f ms\n",
+                format, mode.name, double(count) / objects, count,
+                std::chrono::duration<double, std::milli>(stop - start).count());
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+    std::vector<Node> nodes(n);
+    for (std::size_t i = 0; i < n; i++) {
+        auto& node = nodes[i];
+        node.id = static_cast<int64_t>(i);
+        node.name = "node_" + std::to_string(i);
+        for (std::size_t k = 0; k < leaf_count; k++) {
+            node.leafs.push_back(Leaf{ static_cast<int>(k), k * 0.5 });
+        }
+    }
+
+    pugi::set_memory_management_functions(pugi_allocate, pugi_deallocate);
+
+    IArchive::Register("json.temporary", []()->std::unique_ptr<IArchive> { return std::make_unique<TemporaryArchive>("json.temporary", "json"); });
+    IArchive::Register("xml.temporary", []()->std::unique_ptr<IArchive> { return std::make_unique<TemporaryArchive>("xml.temporary", "xml"); });
+    IArchive::Register("abcbin.temporary", []()->std::unique_ptr<IArchive> { return std::make_unique<TemporaryArchive>("abcbin.temporary", "abcbin"); });
+
+    for (auto format : { "json", "xml", "abcbin" }) {
+        run(format, (std::string(format) + ".temporary").c_str(), nodes);
+    }
+    return 0;
+}
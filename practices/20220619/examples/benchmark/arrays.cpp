@@ -0,0 +1,47 @@
+﻿//大数值数组的写入、读取耗时
+//用法: archiveArrays [元素数],默认100万
+#include "archive.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+    template<typename Fn>
+    double measure(Fn&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(stop - start).count();
+    }
+
+    template<typename T>
+    void run(const char* format, const char* name, const std::vector<T>& values) {
+        auto ar = Archive(format);
+        auto write = measure([&]() { ar->write("values", values); });
+        std::vector<T> result;
+        auto read = measure([&]() { ar->read("values", result); });
+        std::printf("%-8s %-8s: write %9.2f ms, read %9.2f ms, %s\n",
+            format, name, write, read, result == values ? "ok" : "mismatch");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::vector<double> doubles(n);
+    std::vector<int> ints(n);
+    std::vector<std::uint8_t> bytes(n);
+    for (std::size_t i = 0; i < n; i++) {
+        doubles[i] = i * 0.5;
+        ints[i] = static_cast<int>(i) - static_cast<int>(n / 2);
+        bytes[i] = static_cast<std::uint8_t>(i);
+    }
+
+    for (auto format : { "json", "CBOR", "abcbin" }) {
+        run(format, "double", doubles);
+        run(format, "int", ints);
+        run(format, "uint8", bytes);
+    }
+    return 0;
+}
@@ -75,6 +75,21 @@ void test_load_msgpack(std::string const& file) {
     }
 }
 
+void test_stream_json(std::string const& file) {
+    auto ar = Archive("json");
+    std::vector<int> iVs{};
+    ar->stream(file, "iVs", [&](const IArReader& o) {
+        int v{};
+        if (o.read(v)) {
+            iVs.push_back(v);
+        }
+        });
+
+    if (iVs.empty()) {
+
+    }
+}
+
 void test_archive_clone(const Archive& other)
 {
     Archive ar{ other };
@@ -99,6 +114,7 @@ int main() {
         auto result = ar->to_string();
         ar->save("archive.json");
     }
+    test_stream_json("archive.json");
 
     MyObject obj{};
     obj.bV = true;
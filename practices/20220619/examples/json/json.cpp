@@ -1,4 +1,5 @@
 ﻿#include "archive.h"
+#include "mapped_file.h"
 #include "nlohmann/json.hpp"
 #include <fstream>
 #include <iomanip>
@@ -18,6 +19,7 @@ public:
         const  nlohmann::json* j;
         bool try_read(const char* m, Type type, void* v) const;
         bool try_read(const char* m, Type type, IReader& v) const;
+        bool try_read_array(ArElement e, IArrayBuffer& v) const;
     };
 public:
     explicit JsonArReader(const nlohmann::json* json)
@@ -34,12 +36,129 @@ protected:
     bool try_read_impl(const char* m, Type type, IReader& v) const override {
         return Impl{ j }.try_read(m, type, v);
     }
+
+    bool try_read_array(ArElement e, IArrayBuffer& v) const override {
+        return Impl{ j }.try_read_array(e, v);
+    }
+};
+
+/// @brief 流式读取用SAX处理器,只构造目标数组中的当前元素,元素完成后即交给fn处理并释放
+template<typename Fn>
+class JsonStreamSax final :public nlohmann::json::json_sax_t
+{
+    using json = nlohmann::json;
+
+    const char* m;              //根对象成员,为空表示根数组
+    Fn& fn;
+    std::size_t depth{};        //目标数组之外已打开的容器层数
+    std::size_t arrayDepth{};   //目标数组所在层数,0表示尚未找到
+    bool matched{};             //根对象当前键是否为m
+    json element;
+    std::vector<json*> stack;   //当前元素中正在构造的容器
+    json* slot{};               //对象中下一个值的位置
+public:
+    bool found{};
+    bool failed{};
+
+    JsonStreamSax(const char* key, Fn& f)
+        :m(key), fn(f) {};
+
+    bool null() override { return value(json{}); }
+    bool boolean(bool val) override { return value(json(val)); }
+    bool number_integer(number_integer_t val) override { return value(json(val)); }
+    bool number_unsigned(number_unsigned_t val) override { return value(json(val)); }
+    bool number_float(number_float_t val, const string_t&) override { return value(json(val)); }
+    bool string(string_t& val) override { return value(json(std::move(val))); }
+    bool binary(binary_t& val) override { return value(json(std::move(val))); }
+
+    bool start_object(std::size_t) override { return start(json::object()); }
+    bool start_array(std::size_t) override { return start(json::array()); }
+    bool end_object() override { return end(); }
+    bool end_array() override { return end(); }
+
+    bool key(string_t& val) override {
+        if (!stack.empty()) {
+            slot = std::addressof((*stack.back())[val]);
+        }
+        else if (depth == 1 && m) {
+            matched = (val == m);
+        }
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override {
+        failed = true;
+        return false;
+    }
+private:
+    bool atElement() const noexcept {
+        return arrayDepth != 0 && depth == arrayDepth;
+    }
+
+    json* put(json&& val) {
+        auto top = stack.back();
+        if (top->is_array()) {
+            top->emplace_back(std::move(val));
+            return std::addressof(top->back());
+        }
+        *slot = std::move(val);
+        return slot;
+    }
+
+    void emit() {
+        fn(element);
+        element = nullptr;
+    }
+
+    bool value(json&& val) {
+        if (!stack.empty()) {
+            put(std::move(val));
+        }
+        else if (atElement()) {
+            element = std::move(val);
+            emit();
+        }
+        return true;
+    }
+
+    bool start(json&& val) {
+        if (!stack.empty()) {
+            stack.push_back(put(std::move(val)));
+            return true;
+        }
+        if (atElement()) {
+            element = std::move(val);
+            stack.push_back(std::addressof(element));
+            return true;
+        }
+        depth++;
+        if (arrayDepth == 0 && val.is_array() && (m ? (depth == 2 && matched) : depth == 1)) {
+            arrayDepth = depth;
+            found = true;
+        }
+        return true;
+    }
+
+    bool end() {
+        if (!stack.empty()) {
+            stack.pop_back();
+            if (stack.empty()) {
+                emit();
+            }
+            return true;
+        }
+        //目标数组结束,不再解析剩余内容
+        if (atElement()) return false;
+        depth--;
+        return true;
+    }
 };
 
 class JsonArchive :public IArchive
 {
 protected:
     nlohmann::json j;
+    std::vector<nlohmann::json*> scopes;//正在写入的嵌套值,为空时写入j
 public:
     std::unique_ptr<IArchive> clone() const override {
         JsonArchive result{};
@@ -52,8 +171,10 @@ public:
     }
 
     bool open(const std::string& file) override {
-        std::ifstream ifs(file);
-        ifs >> j;
+        //直接解析文件映射区域,不再经由流读取
+        MappedFile mapped{};
+        if (!mapped.open(file)) return false;
+        j = nlohmann::json::parse(mapped.begin(), mapped.end());
         return true;
     }
 
@@ -71,36 +192,49 @@ public:
         return j.size();
     }
 protected:
-    void try_write(const char* m, IWriter& writer) override {
-        JsonArchive ar{};
-        writer.write(ar);
+    nlohmann::json& current() noexcept {
+        return scopes.empty() ? j : *scopes.back();
+    }
+
+    bool begin_scope(const char* m) override {
+        auto& obj = current();
         if (m) {
-            j[m] = std::move(ar.j);
+            //与整体写入一致:替换同名成员,而不是合并到已有的值中
+            auto& slot = obj[m];
+            slot = nullptr;
+            scopes.push_back(std::addressof(slot));
         }
         else {
-            j.emplace_back(std::move(ar.j));
+            obj.emplace_back(nullptr);
+            scopes.push_back(std::addressof(obj.back()));
         }
+        return true;
+    }
+    void end_scope() override {
+        scopes.pop_back();
     }
     bool try_write(const char* m, IArchive& v) override {
         if (auto vp = dynamic_cast<JsonArchive*>(&v)) {
+            auto& node = current();
             if (m) {
-                j[m] = std::move(vp->j);
+                node[m] = std::move(vp->j);
             }
             else
             {
-                j.emplace_back(std::move(vp->j));
+                node.emplace_back(std::move(vp->j));
             }
             return true;
         }
         return false;
     }
     void try_write_impl(const char* m, Type type, const void* v) override {
+        auto& node = current();
         auto write = [&](auto& obj) {
             if (m) {
-                j[m] = obj;
+                node[m] = obj;
             }
             else {
-                j.push_back(obj);
+                node.push_back(obj);
             }
         };
 
@@ -121,10 +255,10 @@ protected:
         {
             auto vp = static_cast<const char*>(v);
             if (m) {
-                j[m] = vp;
+                node[m] = vp;
             }
             else {
-                j.push_back(vp);
+                node.push_back(vp);
             }
         }
         break;
@@ -135,6 +269,26 @@ protected:
             break;
         }
     }
+    void try_write_array(ArElement e, const void* data, std::size_t n) override {
+        auto& node = current();
+        if (n == 0) return;
+        if (node.is_null()) {
+            node = nlohmann::json::array();
+        }
+        if (!node.is_array()) {
+            return IArchive::try_write_array(e, data, n);
+        }
+        //直接构造数值,避免逐个元素经由try_write_impl写入
+        auto& items = node.get_ref<nlohmann::json::array_t&>();
+        items.reserve(items.size() + n);
+        ArVisit(e, [&](auto tag) {
+            using T = decltype(tag);
+            auto p = static_cast<const T*>(data);
+            for (std::size_t i = 0; i < n; i++) {
+                items.emplace_back(p[i]);
+            }
+            });
+    }
     bool try_read_impl(const char* m, Type type, void* v) const override {
         return JsonArReader::Impl{ &j }.try_read(m, type, v);
     }
@@ -142,6 +296,25 @@ protected:
     bool try_read_impl(const char* m, Type type, IReader& v) const override {
         return JsonArReader::Impl{ &j }.try_read(m, type, v);
     }
+
+    bool try_read_array(ArElement e, IArrayBuffer& v) const override {
+        return JsonArReader::Impl{ &j }.try_read_array(e, v);
+    }
+
+    bool try_stream_impl(const std::string& file, const char* m, IReader& v) override {
+        MappedFile mapped{};
+        if (!mapped.open(file)) return false;
+        auto fn = [&](const nlohmann::json& o) {
+            v.read(nullptr, JsonArReader{ std::addressof(o) });
+        };
+        JsonStreamSax<decltype(fn)> sax{ m,fn };
+        nlohmann::json::sax_parse(mapped.begin(), mapped.end(), &sax, input_format());
+        return sax.found && !sax.failed;
+    }
+
+    virtual nlohmann::json::input_format_t input_format() const noexcept {
+        return nlohmann::json::input_format_t::json;
+    }
 };
 
 bool JsonArReader::Impl::try_read(const char* m, Type type, void* v) const
@@ -152,8 +325,6 @@ bool JsonArReader::Impl::try_read(const char* m, Type type, void* v) const
         if (it == j->end()) return false;
         obj = std::addressof(*it);
     }
-    auto str = j->dump();
-    auto str1 = obj->dump();
     switch (type) {
     case Type::Boolean:
         if (obj->is_boolean()) {
@@ -228,6 +399,28 @@ bool JsonArReader::Impl::try_read(const char* m, Type type, IReader& v) const
     return false;
 }
 
+bool JsonArReader::Impl::try_read_array(ArElement e, IArrayBuffer& v) const
+{
+    if (!j->is_array()) return false;
+    auto& items = j->get_ref<const nlohmann::json::array_t&>();
+    ArVisit(e, [&](auto tag) {
+        using T = decltype(tag);
+        auto p = static_cast<T*>(v.resize(items.size()));
+        for (auto& o : items) {
+            //与逐个读取时的类型要求一致,不符合的元素为默认值
+            if constexpr (std::is_floating_point_v<T>) {
+                *p++ = o.is_number() ? o.get<T>() : T{};
+            }
+            else if constexpr (std::is_signed_v<T>) {
+                *p++ = o.is_number_integer() ? o.get<T>() : T{};
+            }
+            else {
+                *p++ = o.is_number_unsigned() ? o.get<T>() : T{};
+            }
+        }
+        });
+    return true;
+}
 
 enum class BinaryJsonType
 {
@@ -243,9 +436,10 @@ struct JsonBinaryFormat;
 template<>
 struct JsonBinaryFormat<BinaryJsonType::BSON> {
     static constexpr auto archive_format = "BSON";
+    static constexpr auto input_format = nlohmann::json::input_format_t::bson;
 
-    static auto  read(const std::vector<uint8_t>& buffer) {
-        return nlohmann::json::from_bson(buffer);
+    static auto  read(const std::uint8_t* first, const std::uint8_t* last) {
+        return nlohmann::json::from_bson(first, last);
     }
 
     static auto  write(const nlohmann::json& j) {
@@ -256,9 +450,10 @@ struct JsonBinaryFormat<BinaryJsonType::BSON> {
 template<>
 struct JsonBinaryFormat<BinaryJsonType::CBOR> {
     static constexpr auto archive_format = "CBOR";
+    static constexpr auto input_format = nlohmann::json::input_format_t::cbor;
 
-    static auto  read(const std::vector<uint8_t>& buffer) {
-        return nlohmann::json::from_cbor(buffer);
+    static auto  read(const std::uint8_t* first, const std::uint8_t* last) {
+        return nlohmann::json::from_cbor(first, last);
     }
     static auto  write(const nlohmann::json& j) {
         return nlohmann::json::to_cbor(j);
@@ -268,9 +463,10 @@ struct JsonBinaryFormat<BinaryJsonType::CBOR> {
 template<>
 struct JsonBinaryFormat<BinaryJsonType::MessagePack> {
     static constexpr auto archive_format = "MessagePack";
+    static constexpr auto input_format = nlohmann::json::input_format_t::msgpack;
 
-    static auto  read(const std::vector<uint8_t>& buffer) {
-        return nlohmann::json::from_msgpack(buffer);
+    static auto  read(const std::uint8_t* first, const std::uint8_t* last) {
+        return nlohmann::json::from_msgpack(first, last);
     }
     static auto  write(const nlohmann::json& j) {
         return nlohmann::json::to_msgpack(j);
@@ -280,9 +476,10 @@ struct JsonBinaryFormat<BinaryJsonType::MessagePack> {
 template<>
 struct JsonBinaryFormat<BinaryJsonType::UBJSON> {
     static constexpr auto archive_format = "UBJSON";
+    static constexpr auto input_format = nlohmann::json::input_format_t::ubjson;
 
-    static auto  read(const std::vector<uint8_t>& buffer) {
-        return nlohmann::json::from_ubjson(buffer);
+    static auto  read(const std::uint8_t* first, const std::uint8_t* last) {
+        return nlohmann::json::from_ubjson(first, last);
     }
     static auto  write(const nlohmann::json& j) {
         return nlohmann::json::to_ubjson(j);
@@ -303,17 +500,17 @@ public:
     }
 
     bool open(const std::string& file) override {
-        std::ifstream ifs(file, std::ios::binary);
-        ifs.seekg(0, ifs.end);
-        auto len = ifs.tellg();
-        ifs.seekg(0, ifs.beg);
-
-        std::vector<std::uint8_t> buffer(len);
-        ifs.read((char*)(buffer.data()), len);
-        j = JsonBinaryFormat<T>::read(buffer);
+        MappedFile mapped{};
+        if (!mapped.open(file)) return false;
+        auto first = reinterpret_cast<const std::uint8_t*>(mapped.begin());
+        j = JsonBinaryFormat<T>::read(first, first + mapped.size());
         return true;
     }
 
+    nlohmann::json::input_format_t input_format() const noexcept override {
+        return JsonBinaryFormat<T>::input_format;
+    }
+
     bool save(const std::string& file) const override {
         std::ofstream ofs(file,std::ios::binary);
         auto buffer = JsonBinaryFormat<T>::write(j);
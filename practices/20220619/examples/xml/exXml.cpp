@@ -77,7 +77,11 @@ void test_archive_clone(const Archive& other)
 template <typename T, T V>
 constexpr const char* InferEnumName()
 {
+#if defined(_MSC_VER) && !defined(__clang__)
     return __FUNCSIG__;
+#else
+    return __PRETTY_FUNCTION__;
+#endif
 }
 
 enum class Fruit
@@ -1,5 +1,6 @@
 ﻿#include "pugixml.hpp"
 #include "archive.h"
+#include "mapped_file.h"
 #include <sstream>
 
 namespace
@@ -39,6 +40,9 @@ class XmlArchive :public  IArchive
 {
     std::shared_ptr<pugi::xml_document> doc;
     pugi::xml_node     node;
+    std::vector<pugi::xml_node> scopes;//进入嵌套成员前的节点
+    //原地解析时文档引用映射区域,需与文档同生命周期
+    std::shared_ptr<MappedFile> mapping;
 public:
     XmlArchive()
         :doc(std::make_shared<pugi::xml_document>())
@@ -46,12 +50,6 @@ public:
         node = doc->append_child();
     }
 
-    XmlArchive(std::shared_ptr<pugi::xml_document> docArg, pugi::xml_node parent)
-        :doc(docArg)
-    {
-        node = parent.append_child();
-    }
-
     std::unique_ptr<IArchive> clone() const override {
         XmlArchive ar{};
         ar.doc = std::make_shared<pugi::xml_document>();
@@ -65,7 +63,13 @@ public:
     }
 
     bool open(const std::string& file)  override {
-        auto result = doc->load_file(file.c_str());
+        //以写时复制方式映射文件,由pugixml原地解析,避免读入额外缓冲区
+        auto mapped = std::make_shared<MappedFile>();
+        if (!mapped->open(file, MappedFile::Mode::CopyOnWrite)) {
+            return false;
+        }
+        auto result = doc->load_buffer_inplace(mapped->data(), mapped->size());
+        mapping = std::move(mapped);
         if (!result) {
             return false;
         }
@@ -91,10 +95,18 @@ public:
 protected:
     void try_write(const char* m, IWriter& writer) override {
         //Xml格式不支持数组
-        if (!m)  return;
-        XmlArchive ar{ doc,node };
-        ar.node.set_name(m);
-        writer.write(ar);
+        if (!m) return;
+        IArchive::try_write(m, writer);
+    }
+    bool begin_scope(const char* m) override {
+        if (!m) return false;
+        scopes.push_back(node);
+        node = node.append_child(m);
+        return true;
+    }
+    void end_scope() override {
+        node = scopes.back();
+        scopes.pop_back();
     }
     bool try_write(const char* m, IArchive& v) override {
         if (auto vp = dynamic_cast<XmlArchive*>(&v)) {